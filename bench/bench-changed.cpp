@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 大部分实体静止时, 对比每帧遍历所有实体和只遍历Changed<Position>的实体
+
+struct Position {
+	float x, y;
+};
+
+struct Bounds {
+	float minX, minY, maxX, maxY;
+};
+
+struct BenchState {
+	size_t count {0};
+	size_t moving {0};
+	size_t frame {0};
+	std::vector<Entity> entities;
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		float f = float(i);
+		state.entities.push_back(commands.SpawnAndReturn<Position, Bounds>(Position{f, f}, Bounds{}));
+	}
+}
+
+//每帧只移动少数实体
+void moveSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.moving; i++) {
+		Entity entity = state.entities[(state.frame * state.moving + i) % state.entities.size()];
+		queryer.Get<Position>(entity).x += 1;
+	}
+	state.frame++;
+}
+
+void updateBounds(const Position& pos, Bounds& bounds) {
+	float r = std::sqrt(pos.x * pos.x + pos.y * pos.y) * 0.01f;
+	bounds = Bounds{pos.x - r, pos.y - r, pos.x + r, pos.y + r};
+}
+
+void boundsAllSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<const Position, Bounds>(updateBounds);
+}
+
+void boundsChangedSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<const Position, Bounds, Changed<Position>>(updateBounds);
+}
+
+double benchChanged(StorageMode storageMode, FSystem system, size_t count, size_t moving, int rounds) {
+	World world(storageMode);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	auto& state = queryer.GetResource<BenchState>();
+	state.count = count;
+	state.moving = moving;
+	world.AddSystem(spawnSystem);
+	world.Update();
+	world.RemoveSystem(spawnSystem);
+
+	world.AddSystem(moveSystem);
+	world.AddSystem(system);
+	world.Update();
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - begin).count() / rounds;
+}
+
+int main() {
+	const int rounds = 20;
+	for (auto [name, system] : {std::make_pair("Each all", boundsAllSystem), std::make_pair("Each Changed", boundsChangedSystem)}) {
+		std::printf("%s, 1%% moving\n", name);
+		std::printf("%12s %20s %20s\n", "entities", "sparse set(us/frame)", "archetype(us/frame)");
+		for (size_t count : {10000u, 100000u, 1000000u}) {
+			std::printf("%12zu %20.1f %20.1f\n", count,
+				benchChanged(StorageMode::SparseSet, system, count, count / 100, rounds),
+				benchChanged(StorageMode::Archetype, system, count, count / 100, rounds));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 测量在不同存活组件数量下, 单个实体销毁的平均耗时
+// 以及按查询批量销毁(DestroyAll)和World::Clear的耗时
+
+struct Position {
+	float x, y;
+};
+
+struct Velocity {
+	float x, y;
+};
+
+struct Expired {};
+
+struct BenchState {
+	size_t live {0};
+	size_t destroyCount {0};
+	std::vector<Entity> entities;
+};
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	state.entities.reserve(state.live);
+	for (size_t i = 0; i < state.live; i++) {
+		state.entities.push_back(commands.SpawnAndReturn<Position, Velocity>(
+			Position{float(i), float(i)}, Velocity{1.0f, 1.0f}));
+	}
+}
+
+void destroySystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.destroyCount; i++) {
+		commands.Destroy(state.entities.back());
+		state.entities.pop_back();
+	}
+}
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+double benchDestroy(size_t live, size_t destroyCount) {
+	World world;
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	auto& state = queryer.GetResource<BenchState>();
+	state.live = live + destroyCount;
+	state.destroyCount = destroyCount;
+
+	world.AddSystem(spawnSystem);
+	world.Update();
+	world.RemoveSystem(spawnSystem);
+
+	// 打乱顺序, 让被销毁的实体分散在packed数组中
+	std::mt19937 rng(42);
+	std::shuffle(state.entities.begin(), state.entities.end(), rng);
+
+	// 先空跑一轮, 让命令缓冲区和分配器进入稳定状态
+	world.AddSystem(destroySystem);
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	world.Update();
+	auto end = std::chrono::steady_clock::now();
+	world.RemoveSystem(destroySystem);
+
+	return std::chrono::duration<double, std::nano>(end - begin).count() / destroyCount;
+}
+
+void spawnExpiredSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	commands.SpawnBatch<Position, Velocity>(state.live, [](size_t i, Position& pos, Velocity& vel) {
+		pos = Position{float(i), float(i)};
+	});
+	commands.SpawnBatch<Position, Velocity, Expired>(state.destroyCount, [](size_t i, Position& pos, Velocity& vel, Expired&) {
+		pos = Position{float(i), float(i)};
+	});
+}
+
+void queryDestroySystem(Commands& commands, Queryer& queryer) {
+	for (Entity entity : queryer.Query<Expired>()) {
+		commands.Destroy(entity);
+	}
+}
+
+void destroyAllSystem(Commands& commands, Queryer& queryer) {
+	commands.DestroyAll<Expired>();
+}
+
+double benchDestroyExpired(StorageMode storageMode, FSystem system, size_t live, size_t destroyCount) {
+	World world(storageMode);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	auto& state = queryer.GetResource<BenchState>();
+	state.live = live;
+	state.destroyCount = destroyCount;
+
+	world.AddSystem(spawnExpiredSystem);
+	world.Update();
+	world.RemoveSystem(spawnExpiredSystem);
+
+	world.AddSystem(system);
+	auto begin = std::chrono::steady_clock::now();
+	world.Update();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+double benchClear(size_t live) {
+	World world;
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().live = live;
+
+	world.AddSystem(spawnExpiredSystem);
+	world.Update();
+	world.RemoveSystem(spawnExpiredSystem);
+
+	auto begin = std::chrono::steady_clock::now();
+	world.Clear();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+int main() {
+	const size_t destroyCount = 1000;
+	std::printf("%12s %16s\n", "live", "ns/destroy");
+	for (size_t live : {1000u, 10000u, 100000u, 1000000u}) {
+		std::printf("%12zu %16.1f\n", live, benchDestroy(live, destroyCount));
+	}
+
+	const size_t live = 100000;
+	std::printf("\ndestroy all Expired among %zu live entities\n", live);
+	std::printf("%12s %22s %22s %22s\n", "expired", "Query+Destroy(us)", "DestroyAll(us)", "DestroyAll arch.(us)");
+	for (size_t expired : {1000u, 100000u}) {
+		std::printf("%12zu %22.1f %22.1f %22.1f\n", expired,
+			benchDestroyExpired(StorageMode::SparseSet, queryDestroySystem, live, expired),
+			benchDestroyExpired(StorageMode::SparseSet, destroyAllSystem, live, expired),
+			benchDestroyExpired(StorageMode::Archetype, destroyAllSystem, live, expired));
+	}
+
+	std::printf("\n%12s %16s\n", "live", "Clear(us)");
+	for (size_t count : {10000u, 100000u, 1000000u}) {
+		std::printf("%12zu %16.1f\n", count, benchClear(count));
+	}
+	return 0;
+}
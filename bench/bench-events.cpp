@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 每帧发送一批消息并由另一个系统读取, 对比事件通道和创建短命的实体
+
+struct Hit {
+	Entity target;
+	int damage;
+};
+
+struct BenchState {
+	size_t count {0};
+	long long total {0};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void sendEventSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		commands.SendEvent(Hit{static_cast<Entity>(i), int(i & 15)});
+	}
+}
+
+void readEventSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (const Hit& hit : queryer.ReadEvents<Hit>()) {
+		state.total += hit.damage;
+	}
+}
+
+void spawnHitSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		commands.Spawn(Hit{static_cast<Entity>(i), int(i & 15)});
+	}
+}
+
+void readHitSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	queryer.Each<const Hit>([&state](const Hit& hit) {
+		state.total += hit.damage;
+	});
+	commands.DestroyAll<Hit>();
+}
+
+double benchEvents(StorageMode storageMode, FSystem send, FSystem read, size_t count, int rounds) {
+	World world(storageMode);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+	world.AddSystem(send);
+	world.AddSystem(read);
+	world.Update();
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / rounds / count;
+}
+
+int main() {
+	const int rounds = 10;
+	struct Case {
+		const char* name;
+		FSystem send;
+		FSystem read;
+	};
+	for (auto& c : {Case{"SendEvent/ReadEvents", sendEventSystem, readEventSystem},
+	                Case{"Spawn/DestroyAll", spawnHitSystem, readHitSystem}}) {
+		std::printf("%s\n", c.name);
+		std::printf("%12s %20s %20s\n", "messages", "sparse set(ns/msg)", "archetype(ns/msg)");
+		for (size_t count : {1000u, 10000u, 100000u}) {
+			std::printf("%12zu %20.1f %20.1f\n", count,
+				benchEvents(StorageMode::SparseSet, c.send, c.read, count, rounds),
+				benchEvents(StorageMode::Archetype, c.send, c.read, count, rounds));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 每帧给所有实体加上或去掉一个标记组件, 对比Insert/Remove和销毁后重新创建
+
+struct Position {
+	float x, y;
+};
+
+struct Velocity {
+	float x, y;
+};
+
+struct Health {
+	int hp;
+};
+
+struct Stunned {
+	int frames;
+};
+
+struct BenchState {
+	size_t count {0};
+	bool stunned {false};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	commands.SpawnBatch<Position, Velocity, Health>(state.count,
+		[](size_t i, Position& pos, Velocity& vel, Health& health) {
+			float f = float(i);
+			pos = Position{f, f};
+			vel = Velocity{1, 1};
+			health = Health{100};
+		});
+}
+
+void insertRemoveSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	state.stunned = !state.stunned;
+	queryer.Each<Position>([&](Entity entity) {
+		if (state.stunned) {
+			commands.Insert(entity, Stunned{3});
+		} else {
+			commands.Remove<Stunned>(entity);
+		}
+	});
+}
+
+void respawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	state.stunned = !state.stunned;
+	queryer.Each<const Position, const Velocity, const Health>(
+		[&](Entity entity, const Position& pos, const Velocity& vel, const Health& health) {
+			commands.Destroy(entity);
+			if (state.stunned) {
+				commands.Spawn(Position{pos}, Velocity{vel}, Health{health}, Stunned{3});
+			} else {
+				commands.Spawn(Position{pos}, Velocity{vel}, Health{health});
+			}
+		});
+}
+
+double benchInsert(StorageMode storageMode, FSystem system, size_t count, int rounds) {
+	World world(storageMode);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+	world.AddSystem(spawnSystem);
+	world.Update();
+	world.RemoveSystem(spawnSystem);
+
+	world.AddSystem(system);
+	world.Update();
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / rounds / count;
+}
+
+int main() {
+	const int rounds = 10;
+	for (auto [name, system] : {std::make_pair("Insert/Remove", insertRemoveSystem), std::make_pair("Destroy+Spawn", respawnSystem)}) {
+		std::printf("%s\n", name);
+		std::printf("%12s %22s %22s\n", "entities", "sparse set(ns/entity)", "archetype(ns/entity)");
+		for (size_t count : {1000u, 10000u, 100000u}) {
+			std::printf("%12zu %22.1f %22.1f\n", count,
+				benchInsert(StorageMode::SparseSet, system, count, rounds),
+				benchInsert(StorageMode::Archetype, system, count, rounds));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "cppecs/sparse_set.hpp"
+
+using namespace cppecs;
+
+// 用一个集合过滤另一个集合的packed, 对比逐个contain和批量的intersect
+// 批量版本在开启CPPECS_ENABLE_AVX2时使用gather, 否则是标量实现
+
+using Set = basic_sparse_set<uint32_t, 1024>;
+
+constexpr uint32_t EntityCount = 1000000;
+
+template<typename Func>
+double best(Func&& func) {
+	double result = 1e30;
+	for (int round = 0; round < 10; round++) {
+		auto begin = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		result = std::min(result, std::chrono::duration<double, std::nano>(end - begin).count() / EntityCount);
+	}
+	return result;
+}
+
+//ordered: 实体按ID顺序创建, 另一个集合是随机选出的子集, 也按ID顺序加入
+//shuffled: 两个集合都按随机顺序加入, 查找基本都不命中缓存
+int benchIntersect(bool shuffled) {
+	std::vector<uint32_t> ids(EntityCount);
+	for (uint32_t i = 0; i < EntityCount; i++) {
+		ids[i] = i;
+	}
+	std::mt19937 rng(1);
+	if (shuffled) {
+		std::shuffle(ids.begin(), ids.end(), rng);
+	}
+
+	Set driving;
+	for (uint32_t id : ids) {
+		driving.insert(id);
+	}
+	std::vector<uint32_t> out(EntityCount);
+
+	std::printf("%s\n", shuffled ? "shuffled" : "ordered");
+	std::printf("%12s %18s %18s %10s\n", "selectivity", "contain(ns/ent)", "intersect(ns/ent)", "speedup");
+	for (double selectivity : {0.01, 0.1, 0.5, 0.9, 1.0}) {
+		std::vector<uint32_t> subset(ids);
+		std::shuffle(subset.begin(), subset.end(), rng);
+		subset.resize(size_t(EntityCount * selectivity));
+		if (!shuffled) {
+			std::sort(subset.begin(), subset.end());
+		}
+		Set other;
+		for (uint32_t id : subset) {
+			other.insert(id);
+		}
+
+		size_t scalarCount = 0, batchCount = 0;
+		double scalar = best([&] {
+			size_t n = 0;
+			for (uint32_t entity : driving.packed()) {
+				if (other.contain(entity)) {
+					out[n++] = entity;
+				}
+			}
+			scalarCount = n;
+		});
+		double batch = best([&] {
+			batchCount = other.intersect(driving.packed().data(), driving.size(), out.data());
+		});
+		if (scalarCount != batchCount) {
+			std::printf("mismatch %zu != %zu\n", scalarCount, batchCount);
+			return 1;
+		}
+		std::printf("%11.0f%% %18.2f %18.2f %9.2fx\n", selectivity * 100, scalar, batch, scalar / batch);
+	}
+	return 0;
+}
+
+int main() {
+#if defined(__AVX2__)
+	std::printf("batched path: avx2\n");
+#else
+	std::printf("batched path: scalar\n");
+#endif
+	return benchIntersect(false) || benchIntersect(true);
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// ParEach 在不同线程数和grainSize下的耗时, 和单线程Each对比
+
+struct Position {
+	float x, y;
+};
+
+struct Velocity {
+	float x, y;
+};
+
+struct BenchState {
+	size_t count {0};
+	size_t grainSize {QueryView<Position>::DefaultGrainSize};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		float f = float(i);
+		commands.Spawn<Position, Velocity>(Position{f, f}, Velocity{1, 1});
+	}
+}
+
+//每个实体做一点计算, 避免只测到内存带宽
+void integrate(Position& pos, const Velocity& vel) {
+	pos.x = std::sqrt(pos.x * pos.x + 1.0f) + vel.x;
+	pos.y = std::sqrt(pos.y * pos.y + 1.0f) + vel.y;
+}
+
+void eachSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<Position, const Velocity>(integrate);
+}
+
+void parEachSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	queryer.ParEach<Position, const Velocity>(integrate, state.grainSize);
+}
+
+double benchParEach(FSystem system, size_t count, size_t threads, size_t grainSize, int rounds) {
+	World world;
+	world.SetThreadCount(threads);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+	queryer.GetResource<BenchState>().grainSize = grainSize;
+
+	world.AddSystem(spawnSystem);
+	world.Update();
+	world.RemoveSystem(spawnSystem);
+
+	world.AddSystem(system);
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - begin).count() / rounds;
+}
+
+int main() {
+	const int rounds = 10;
+	//实体ID只有20位, 不能超过2^20
+	const size_t count = 1000000;
+	size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+
+	double base = benchParEach(eachSystem, count, 1, 0, rounds);
+	std::printf("%zu entities, Each: %.1f us\n", count, base);
+	std::printf("%8s %12s %12s %10s\n", "threads", "grain size", "ParEach(us)", "speedup");
+	for (size_t threads = 1; threads <= hardware; threads *= 2) {
+		for (size_t grainSize : {256u, 4096u, 65536u}) {
+			double t = benchParEach(parEachSystem, count, threads, grainSize, rounds);
+			std::printf("%8zu %12zu %12.1f %10.2f\n", threads, grainSize, t, base / t);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 对比两种存储方式下, 多组件查询并读取组件的耗时
+
+struct Position {
+	float x, y;
+};
+
+struct Velocity {
+	float x, y;
+};
+
+struct Health {
+	int hp;
+};
+
+struct Tag {};
+
+struct BenchState {
+	size_t count {0};
+	float sum {0};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		float f = float(i);
+		switch (i % 4) {
+		case 0:
+			commands.Spawn<Position>(Position{f, f});
+			break;
+		case 1:
+			commands.Spawn<Position, Velocity>(Position{f, f}, Velocity{1, 1});
+			break;
+		case 2:
+			commands.Spawn<Position, Velocity, Health>(Position{f, f}, Velocity{1, 1}, Health{100});
+			break;
+		default:
+			commands.Spawn<Velocity, Health, Tag>(Velocity{1, 1}, Health{100}, Tag{});
+			break;
+		}
+	}
+}
+
+void querySystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (Entity entity : queryer.Query<Position, Velocity>()) {
+		auto& pos = queryer.Get<Position>(entity);
+		auto& vel = queryer.Get<Velocity>(entity);
+		pos.x += vel.x;
+		pos.y += vel.y;
+		state.sum += pos.x;
+	}
+}
+
+void eachSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	queryer.Each<Position, const Velocity>([&state](Position& pos, const Velocity& vel) {
+		pos.x += vel.x;
+		pos.y += vel.y;
+		state.sum += pos.x;
+	});
+}
+
+void groupSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	queryer.Group<Position, const Velocity>().each([&state](Position& pos, const Velocity& vel) {
+		pos.x += vel.x;
+		pos.y += vel.y;
+		state.sum += pos.x;
+	});
+}
+
+double benchQuery(StorageMode storageMode, FSystem system, size_t count, int rounds) {
+	World world(storageMode);
+	if (system == groupSystem) {
+		world.AddGroup<Position, Velocity>();
+	}
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+
+	world.AddSystem(spawnSystem);
+	world.Update();
+	world.RemoveSystem(spawnSystem);
+
+	world.AddSystem(system);
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - begin).count() / rounds;
+}
+
+int main() {
+	const int rounds = 20;
+	for (auto [name, system] : {std::make_pair("Query+Get", querySystem), std::make_pair("Each", eachSystem), std::make_pair("Group", groupSystem)}) {
+		std::printf("%s\n", name);
+		std::printf("%12s %16s %16s\n", "entities", "sparse set(us)", "archetype(us)");
+		for (size_t count : {1000u, 10000u, 100000u, 1000000u}) {
+			std::printf("%12zu %16.1f %16.1f\n", count,
+				benchQuery(StorageMode::SparseSet, system, count, rounds),
+				benchQuery(StorageMode::Archetype, system, count, rounds));
+		}
+	}
+	return 0;
+}
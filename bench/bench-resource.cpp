@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 系统在循环里反复读取配置和时间等资源, 测每次GetResource的开销
+
+struct Time {
+	float delta {0.016f};
+};
+
+struct Gravity {
+	float y {-9.8f};
+};
+
+struct Config {
+	int maxSpeed {10};
+	char name[256] {};
+};
+
+struct BenchState {
+	size_t count {0};
+	float total {0};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+	commands.SetResource<Time>(Time{});
+	commands.SetResource<Gravity>(Gravity{});
+	commands.SetResource<Config>(Config{});
+}
+
+void readResourceSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	float total = 0;
+	for (size_t i = 0; i < state.count; i++) {
+		total += queryer.GetResource<Time>().delta * queryer.GetResource<Gravity>().y;
+		total += float(queryer.GetResource<Config>().maxSpeed);
+		total += queryer.HasResource<Gravity>() ? 1.0f : 0.0f;
+	}
+	state.total += total;
+}
+
+double benchResource(size_t count, int rounds) {
+	World world;
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+	world.AddSystem(readResourceSystem);
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	//每次循环访问4次资源
+	return std::chrono::duration<double, std::nano>(end - begin).count() / rounds / count / 4;
+}
+
+int main() {
+	const int rounds = 20;
+	std::printf("%12s %20s\n", "iterations", "ns/access");
+	for (size_t count : {1000u, 100000u, 1000000u}) {
+		std::printf("%12zu %20.2f\n", count, benchResource(count, rounds));
+	}
+	return 0;
+}
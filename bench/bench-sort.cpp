@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// Velocity的顺序被打乱后, 对比同时遍历Position和Velocity在Respect前后的耗时, 以及Sort/Respect本身的耗时
+
+struct Position {
+	float x, y;
+};
+
+struct Velocity {
+	float x, y;
+	uint32_t key; //打乱顺序用的随机键
+};
+
+struct BenchState {
+	size_t count {0};
+	float sum {0};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		float f = float(i);
+		uint32_t key = uint32_t(i) * 2654435761u;
+		commands.Spawn<Position, Velocity>(Position{f, f}, Velocity{1, 1, key});
+	}
+}
+
+void moveSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<Position, const Velocity>([](Position& pos, const Velocity& vel) {
+		pos.x += vel.x;
+		pos.y += vel.y;
+	});
+}
+
+template<typename Func>
+double measure(Func&& func, int rounds) {
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		func();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(end - begin).count() / rounds;
+}
+
+int main() {
+	const int rounds = 10;
+	std::printf("%12s %16s %16s %16s %16s\n", "entities", "shuffled(us)", "respected(us)", "Sort(us)", "Respect(us)");
+	for (size_t count : {10000u, 100000u, 1000000u}) {
+		World world;
+		world.AddSystem(setStateSystem);
+		world.Update();
+		world.RemoveSystem(setStateSystem);
+
+		Queryer queryer(world);
+		queryer.GetResource<BenchState>().count = count;
+		world.AddSystem(spawnSystem);
+		world.Update();
+		world.RemoveSystem(spawnSystem);
+		world.AddSystem(moveSystem);
+
+		auto byKey = [](const Velocity& lhs, const Velocity& rhs) { return lhs.key < rhs.key; };
+		double sort = measure([&]() { world.Sort<Velocity>(byKey); }, 1);
+		double shuffled = measure([&]() { world.Update(); }, rounds);
+		double respect = measure([&]() { world.Respect<Velocity, Position>(); }, 1);
+		double respected = measure([&]() { world.Update(); }, rounds);
+		std::printf("%12zu %16.1f %16.1f %16.1f %16.1f\n", count, shuffled, respected, sort, respect);
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 每帧创建并销毁一批实体, 统计每个实体的平均耗时
+
+struct Position {
+	float x, y;
+};
+
+struct Velocity {
+	float x, y;
+};
+
+struct Health {
+	int hp;
+};
+
+struct BenchState {
+	size_t count {0};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+//销毁上一帧创建的实体, 再创建一批新的
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (Entity entity : queryer.Query<Position>()) {
+		commands.Destroy(entity);
+	}
+	for (size_t i = 0; i < state.count; i++) {
+		float f = float(i);
+		commands.Spawn<Position, Velocity, Health>(Position{f, f}, Velocity{1, 1}, Health{100});
+	}
+}
+
+void spawnBatchSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (Entity entity : queryer.Query<Position>()) {
+		commands.Destroy(entity);
+	}
+	commands.SpawnBatch<Position, Velocity, Health>(state.count, 
+		[](size_t i, Position& pos, Velocity& vel, Health& health) {
+			float f = float(i);
+			pos = Position{f, f};
+			vel = Velocity{1, 1};
+			health = Health{100};
+		});
+}
+
+double benchSpawn(StorageMode storageMode, FSystem system, size_t count, int rounds) {
+	World world(storageMode);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+
+	world.AddSystem(system);
+	world.Update();
+	world.Update();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) {
+		world.Update();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - begin).count() / rounds / count;
+}
+
+int main() {
+	const int rounds = 10;
+	for (auto [name, system] : {std::make_pair("Spawn", spawnSystem), std::make_pair("SpawnBatch", spawnBatchSystem)}) {
+		std::printf("%s\n", name);
+		std::printf("%12s %20s %20s\n", "entities", "sparse set(ns/spawn)", "archetype(ns/spawn)");
+		for (size_t count : {1000u, 10000u, 100000u, 500000u}) {
+			std::printf("%12zu %20.1f %20.1f\n", count,
+				benchSpawn(StorageMode::SparseSet, system, count, rounds),
+				benchSpawn(StorageMode::Archetype, system, count, rounds));
+		}
+	}
+	return 0;
+}
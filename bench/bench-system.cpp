@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "cppecs/cppecs.hpp"
+
+using namespace cppecs;
+
+// 单元测试testSystem的负载放大到1M实体: 创建, 逐个Get/Has, Each/Optional查询, 销毁
+
+struct Name {
+	std::string name;
+};
+
+struct ID {
+	int id;
+};
+
+struct Timer {
+	int t;
+};
+
+struct BenchState {
+	size_t count {0};
+	long long sum {0};
+};
+
+void setStateSystem(Commands& commands, Queryer& queryer) {
+	commands.SetResource<BenchState>(BenchState{});
+}
+
+void spawnSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	for (size_t i = 0; i < state.count; i++) {
+		int id = int(i);
+		switch (i % 4) {
+		case 0:
+			commands.Spawn<Name>(Name{"person"});
+			break;
+		case 1:
+		case 2:
+			commands.Spawn<Name, ID>(Name{"person"}, ID{id});
+			break;
+		default:
+			commands.Spawn<ID>(ID{id});
+			break;
+		}
+	}
+}
+
+void checkSystem(Commands& commands, Queryer& queryer) {
+	auto& state = queryer.GetResource<BenchState>();
+	long long sum = 0;
+	for (Entity entity : queryer.Query<Name>()) {
+		sum += queryer.Get<Name>(entity).name.size();
+	}
+	for (Entity entity : queryer.Query<ID>()) {
+		sum += queryer.Get<const ID>(entity).id;
+	}
+	queryer.Each<const Name, ID>([&](Entity entity, const Name& name, ID& id) {
+		sum += id.id + queryer.Has<Timer>(entity);
+	});
+	queryer.Each<Name, Optional<const ID>>([&](Entity entity, Name& name, const ID* id) {
+		sum += (id != nullptr) + queryer.Has<ID>(entity);
+	});
+	sum += queryer.Query<Name, Without<ID>>().size();
+	state.sum += sum;
+}
+
+void destroySystem(Commands& commands, Queryer& queryer) {
+	for (Entity entity : queryer.Query<Name>()) {
+		commands.Destroy(entity);
+	}
+	for (Entity entity : queryer.Query<ID, Without<Name>>()) {
+		commands.Destroy(entity);
+	}
+}
+
+template<typename Func>
+double measure(Func&& func) {
+	auto begin = std::chrono::steady_clock::now();
+	func();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+void benchSystem(StorageMode storageMode, const char* name, size_t count, int rounds) {
+	World world(storageMode);
+	world.AddSystem(setStateSystem);
+	world.Update();
+	world.RemoveSystem(setStateSystem);
+
+	Queryer queryer(world);
+	queryer.GetResource<BenchState>().count = count;
+
+	//机器负载会有波动, 取每个阶段最快的一轮
+	double spawn = 1e30, check = 1e30, destroy = 1e30;
+	for (int i = 0; i < rounds; i++) {
+		world.AddSystem(spawnSystem);
+		spawn = std::min(spawn, measure([&] { world.Update(); }));
+		world.RemoveSystem(spawnSystem);
+
+		world.AddSystem(checkSystem);
+		check = std::min(check, measure([&] { world.Update(); }));
+		world.RemoveSystem(checkSystem);
+
+		world.AddSystem(destroySystem);
+		destroy = std::min(destroy, measure([&] { world.Update(); }));
+		world.RemoveSystem(destroySystem);
+	}
+	std::printf("%12s %14.1f %14.1f %14.1f\n", name, spawn, check, destroy);
+}
+
+int main() {
+	const size_t count = 1000000;
+	const int rounds = 5;
+	std::printf("%zu entities (ms)\n", count);
+	std::printf("%12s %14s %14s %14s\n", "storage", "spawn", "query/get", "destroy");
+	benchSystem(StorageMode::SparseSet, "sparse set", count, rounds);
+	benchSystem(StorageMode::Archetype, "archetype", count, rounds);
+	return 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "cppecs/entity.hpp"
+#include "cppecs/tick.hpp"
+#include "cppecs/utility.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace cppecs {
+
+namespace internal {
+
+//! @brief type erased column of an archetype table
+struct column {
+    //! @brief ticks of every row, kept by basic_archetype
+    std::vector<component_ticks> ticks;
+
+    virtual ~column() = default;
+
+    //! @brief move construct a new row from the object data points to
+    virtual void push(void* data) = 0;
+    //! @brief move the last row to row and drop the tail
+    virtual void swap_and_pop(size_t row) noexcept = 0;
+    //! @brief swap the objects of two rows
+    virtual void swap(size_t lhs, size_t rhs) noexcept = 0;
+    virtual void* get(size_t row) noexcept = 0;
+    virtual void reserve(size_t size) = 0;
+    virtual void clear() noexcept = 0;
+};
+
+template <typename Type>
+struct typed_column final : public column {
+    std::vector<Type> data;
+
+    void push(void* src) override {
+        data.push_back(std::move(*static_cast<Type*>(src)));
+    }
+
+    void swap_and_pop(size_t row) noexcept override {
+        if (row + 1u != data.size()) {
+            data[row] = std::move(data.back());
+        }
+        data.pop_back();
+    }
+
+    void swap(size_t lhs, size_t rhs) noexcept override {
+        using std::swap;
+        swap(data[lhs], data[rhs]);
+    }
+
+    void* get(size_t row) noexcept override { return &data[row]; }
+
+    void reserve(size_t size) override { data.reserve(size); }
+
+    void clear() noexcept override { data.clear(); }
+};
+
+}  // namespace internal
+
+/**
+ * @brief table of all entities which own exactly the same component set,
+ *        every component type is a column and every entity a row
+ * @tparam EntityT  the entity type
+ * @tparam IDT  the component id type
+ **/
+template <typename EntityT, typename IDT>
+class basic_archetype final {
+public:
+    using entity_type = EntityT;
+    using id_type = IDT;
+    using column_type = internal::column;
+    using column_ptr = std::unique_ptr<column_type>;
+
+    //! @param components  sorted component ids
+    //! @param columns  a column for each component id, in the same order
+    basic_archetype(std::vector<id_type> components,
+                    std::vector<column_ptr> columns)
+        : components_(std::move(components)), columns_(std::move(columns)) {
+        GECS_ASSERT(components_.size() == columns_.size(),
+                    "every component need a column");
+        GECS_ASSERT(std::is_sorted(components_.begin(), components_.end()),
+                    "component ids must be sorted");
+    }
+
+    const std::vector<id_type>& components() const noexcept {
+        return components_;
+    }
+
+    bool has(id_type id) const noexcept {
+        return std::binary_search(components_.begin(), components_.end(), id);
+    }
+
+    //! @brief get the column of a component, nullptr if not in this table
+    column_type* column(id_type id) const noexcept {
+        auto it = std::lower_bound(components_.begin(), components_.end(), id);
+        if (it == components_.end() || *it != id) {
+            return nullptr;
+        }
+        return columns_[it - components_.begin()].get();
+    }
+
+    //! @brief append an entity and return it's row, the caller must push
+    //!        one element to every column after that
+    //! @param ticks  the ticks of every component in the new row
+    size_t push(entity_type entity, component_ticks ticks = {}) {
+        for (auto& column : columns_) {
+            column->ticks.push_back(ticks);
+        }
+        entities_.push_back(entity);
+        return entities_.size() - 1u;
+    }
+
+    //! @brief remove a row, return the entity moved into it or null_entity
+    //!        if the row was the last one
+    entity_type swap_and_pop(size_t row) noexcept {
+        for (auto& column : columns_) {
+            column->swap_and_pop(row);
+            column->ticks[row] = column->ticks.back();
+            column->ticks.pop_back();
+        }
+        entity_type moved = null_entity;
+        if (row + 1u != entities_.size()) {
+            moved = entities_.back();
+            entities_[row] = moved;
+        }
+        entities_.pop_back();
+        return moved;
+    }
+
+    //! @brief swap two rows in every column
+    void swap_rows(size_t lhs, size_t rhs) noexcept {
+        for (auto& column : columns_) {
+            column->swap(lhs, rhs);
+            std::swap(column->ticks[lhs], column->ticks[rhs]);
+        }
+        std::swap(entities_[lhs], entities_[rhs]);
+    }
+
+    //! @brief sort the rows in the order of compare, the caller must update
+    //!        the rows it keeps for the entities after that
+    //! @param compare  strict weak ordering of two rows, it is called before
+    //!        anything moves
+    template <typename Compare>
+    void sort(Compare compare) {
+        std::vector<size_t> order(entities_.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), std::move(compare));
+        // where[r] is the current row of the original row r, who is the
+        // inverse of it
+        std::vector<size_t> where(order.size()), who(order.size());
+        std::iota(where.begin(), where.end(), size_t(0));
+        std::iota(who.begin(), who.end(), size_t(0));
+        for (size_t row = 0; row < order.size(); row++) {
+            size_t src = where[order[row]];
+            if (src != row) {
+                swap_rows(row, src);
+                where[who[row]] = src;
+                who[src] = who[row];
+                where[order[row]] = row;
+                who[row] = order[row];
+            }
+        }
+    }
+
+    //! @brief reserve rows in every column
+    void reserve(size_t size) {
+        entities_.reserve(size);
+        for (auto& column : columns_) {
+            column->reserve(size);
+            column->ticks.reserve(size);
+        }
+    }
+
+    const std::vector<entity_type>& entities() const noexcept {
+        return entities_;
+    }
+
+    size_t size() const noexcept { return entities_.size(); }
+
+    bool empty() const noexcept { return entities_.empty(); }
+
+    void clear() noexcept {
+        for (auto& column : columns_) {
+            column->clear();
+            column->ticks.clear();
+        }
+        entities_.clear();
+    }
+
+private:
+    std::vector<id_type> components_;
+    std::vector<column_ptr> columns_;
+    std::vector<entity_type> entities_;
+};
+
+}  // namespace cppecs
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "cppecs/utility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cppecs {
+
+/**
+ * @brief bump pointer allocator, memory is only released all at once by
+ *        reset(), destructors are never called by the arena
+ **/
+class linear_arena final {
+public:
+    explicit linear_arena(size_t block_size = 64u * 1024u)
+        : block_size_(block_size) {}
+
+    linear_arena(const linear_arena&) = delete;
+    linear_arena& operator=(const linear_arena&) = delete;
+    linear_arena(linear_arena&&) = default;
+    linear_arena& operator=(linear_arena&&) = default;
+
+    void* allocate(size_t size, size_t align) {
+        GECS_ASSERT(align != 0 && (align & (align - 1)) == 0,
+                    "alignment must be a power of two");
+        while (current_ < blocks_.size()) {
+            if (void* ptr = try_allocate(blocks_[current_], size, align)) {
+                return ptr;
+            }
+            current_++;
+            offset_ = 0;
+        }
+        blocks_.push_back(make_block(std::max(block_size_, size + align)));
+        return try_allocate(blocks_.back(), size, align);
+    }
+
+    //! @brief construct an object in the arena
+    template <typename Type, typename... Args>
+    Type* create(Args&&... args) {
+        void* ptr = allocate(sizeof(Type), alignof(Type));
+        return new (ptr) Type(std::forward<Args>(args)...);
+    }
+
+    //! @brief uninitialized storage for count objects of a trivial type
+    template <typename Type>
+    Type* allocate_array(size_t count) {
+        static_assert(std::is_trivially_destructible_v<Type>,
+                      "arena never calls destructors of arrays");
+        return static_cast<Type*>(allocate(sizeof(Type) * count, alignof(Type)));
+    }
+
+    //! @brief release everything, the memory is kept for reuse and merged
+    //!        into one block if the last round needed more than one
+    void reset() {
+        if (blocks_.size() > 1) {
+            size_t total = 0;
+            for (auto& block : blocks_) {
+                total += block.size;
+            }
+            blocks_.clear();
+            blocks_.push_back(make_block(total));
+        }
+        current_ = 0;
+        offset_ = 0;
+    }
+
+    size_t capacity() const noexcept {
+        size_t total = 0;
+        for (auto& block : blocks_) {
+            total += block.size;
+        }
+        return total;
+    }
+
+private:
+    struct block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    static block make_block(size_t size) {
+        return block{std::unique_ptr<std::byte[]>(new std::byte[size]), size};
+    }
+
+    void* try_allocate(block& block, size_t size, size_t align) noexcept {
+        auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+        size_t begin = ((base + offset_ + align - 1) & ~(align - 1)) - base;
+        if (begin + size > block.size) {
+            return nullptr;
+        }
+        offset_ = begin + size;
+        return block.data.get() + begin;
+    }
+
+    size_t block_size_;
+    std::vector<block> blocks_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+};
+
+}  // namespace cppecs
@@ -3,11 +3,29 @@
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <unordered_map>
 #include <type_traits>
 #include <functional>
+#include <memory>
+#include <map>
+#include <array>
+#include <iterator>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <utility>
 
 #include "cppecs/sparse_set.hpp"
+#include "cppecs/storage.hpp"
+#include "cppecs/archetype.hpp"
+#include "cppecs/thread_pool.hpp"
+#include "cppecs/arena.hpp"
+#include "cppecs/tick.hpp"
+#include "cppecs/type_id.hpp"
 
 #define assertm(msg, expr) assert(((void)msg, (expr)))
 
@@ -15,553 +33,2702 @@ namespace cppecs {
 
 using ComponentID = uint32_t;
 using Entity = uint32_t;
+using Tick = tick_type;
 
 struct Resource{};
 struct Component{};
-
+struct Event{};
+
+//! @brief 每种类别(组件/资源/事件)的类型ID
+//!        ID是从1开始的连续整数, 用作数组下标, 每个模板实例分配一次, 不按类型名去重;
+//!        ID按s_index的动态初始化顺序分配, 跨翻译单元的初始化顺序不确定, 换一次构建(或链接顺序)ID就可能不同,
+//!        所以ID只在本次运行内有效, 不要保存或在进程间传递
+//!        类型名的哈希在编译期算出, 不随使用顺序和构建变化: 保存World布局时只记录哈希(Hash), 加载时用Find换回ID
+//!        不同翻译单元匿名命名空间里的同名类型是不同的类型, ID不同, 哈希相同, Find对它们返回0
 template<typename Category>
-class IndexGetter final {
+class TypeRegistry final {
 public:
     template <typename T>
     static ComponentID Get() {
-        static ComponentID id = ++m_curIdx;
+        //s_index在main之前注册好, 读取不需要加锁和静态变量的初始化检查;
+        //只有其他全局变量初始化时先用到, 才会为0, 这时直接注册
+        ComponentID id = s_index<T>;
+        return id ? id : assure<T>();
+    }
+
+    template <typename T>
+    static constexpr type_hash_type Hash() {
+        return type_hash<T>();
+    }
+
+    //! @brief 类型ID对应的哈希, 没有注册时返回0
+    static type_hash_type Hash(ComponentID id) {
+        Registry& r = registry();
+        std::lock_guard lock(r.m_mutex);
+        return id > 0 && id <= r.m_types.size() ? r.m_types[id - 1].m_hash : 0;
+    }
+
+    //! @brief 哈希对应的类型ID, 没有注册或者有多个类型的哈希相同时返回0
+    static ComponentID Find(type_hash_type hash) {
+        Registry& r = registry();
+        std::lock_guard lock(r.m_mutex);
+        auto it = r.m_index.find(hash);
+        return it != r.m_index.end() ? it->second : 0;
+    }
+
+    //! @brief 注册一个只知道名字的类型(没有对应的C++类型), 哈希已经注册过时返回原来的ID; 可以在多个线程同时调用
+    //!        name会复制一份, 调用后可以释放
+    static ComponentID Register(type_hash_type hash, std::string_view name) {
+        Registry& r = registry();
+        std::lock_guard lock(r.m_mutex);
+        auto it = r.m_index.find(hash);
+        if (it != r.m_index.end() && it->second) {
+            assertm("type hash collision", r.m_types[it->second - 1].m_name == name);
+            return it->second;
+        }
+        return allocate(r, hash, name);
+    }
+
+private:
+    struct TypeInfo {
+        type_hash_type m_hash;
+        std::string m_name; //Register传入的名字可能是临时的, 保存副本
+    };
+
+    struct Registry {
+        std::mutex m_mutex;
+        std::unordered_map<type_hash_type, ComponentID> m_index; //多个类型的哈希相同时为0
+        std::vector<TypeInfo> m_types;
+    };
+
+    //在第一次使用时构造, 不受全局变量初始化顺序影响
+    static Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    //调用时已经加锁
+    static ComponentID allocate(Registry& r, type_hash_type hash, std::string_view name) {
+        ComponentID id = static_cast<ComponentID>(r.m_types.size() + 1);
+        r.m_types.push_back(TypeInfo{hash, std::string(name)});
+        auto [it, inserted] = r.m_index.try_emplace(hash, id);
+        if (!inserted) {
+            it->second = 0;
+        }
+        return id;
+    }
+
+    //每个模板实例的ID只分配一次, 局部静态变量的初始化是线程安全的
+    template <typename T>
+    static ComponentID assure() {
+        static const ComponentID id = [] {
+            Registry& r = registry();
+            std::lock_guard lock(r.m_mutex);
+            return allocate(r, type_hash<T>(), type_name<T>());
+        }();
         return id;
     }
+
+    template <typename T>
+    inline static const ComponentID s_index = assure<T>();
+};
+
+class Commands;
+class Queryer;
+template<typename ...QueryTerms>
+class QueryView;
+template<typename ...ComponentTypes>
+class GroupView;
+
+using FStartUpSystem = void(*)(Commands&, Queryer&);
+using FSystem = void(*)(Commands&, Queryer&);
+
+//! @brief 查询条件, 实体不能拥有该组件
+template<typename ComponentType>
+struct Without {};
+
+//! @brief 查询条件, 实体可以没有该组件, each中以指针传入
+template<typename ComponentType>
+struct Optional {};
+
+//! @brief 查询条件, 实体拥有该组件, 且组件在当前系统上次运行之后才添加, 不传入each
+template<typename ComponentType>
+struct Added {};
+
+//! @brief 查询条件, 实体拥有该组件, 且组件在当前系统上次运行之后添加或修改过, 不传入each
+//!        通过Commands添加/替换, 以及通过非const的引用访问(Get<T>, 查询条件T)都算修改
+template<typename ComponentType>
+struct Changed {};
+
+namespace internal {
+
+enum class query_term_kind {
+    required,
+    exclude,
+    optional,
+    added,
+    changed,
+};
+
+//! @brief 实体必须拥有该组件的查询条件
+constexpr bool is_required_term(query_term_kind kind) {
+    return kind == query_term_kind::required || kind == query_term_kind::added || kind == query_term_kind::changed;
+}
+
+template<typename Term>
+struct query_term {
+    static constexpr query_term_kind kind = query_term_kind::required;
+    using component_type = Term;
+};
+
+template<typename ComponentType>
+struct query_term<Without<ComponentType>> {
+    static constexpr query_term_kind kind = query_term_kind::exclude;
+    using component_type = ComponentType;
+};
+
+template<typename ComponentType>
+struct query_term<Optional<ComponentType>> {
+    static constexpr query_term_kind kind = query_term_kind::optional;
+    using component_type = ComponentType;
+};
+
+template<typename ComponentType>
+struct query_term<Added<ComponentType>> {
+    static constexpr query_term_kind kind = query_term_kind::added;
+    using component_type = ComponentType;
+};
+
+template<typename ComponentType>
+struct query_term<Changed<ComponentType>> {
+    static constexpr query_term_kind kind = query_term_kind::changed;
+    using component_type = ComponentType;
+};
+
+//! @brief 按func能接受的参数调用: (Entity, Components&...), (Components&...) 或 (Entity)
+template<typename Func, typename ...Refs>
+void invoke_each(Func& func, Entity entity, Refs&... refs) {
+    if constexpr (std::is_invocable_v<Func&, Entity, Refs&...>) {
+        func(entity, refs...);
+    } else if constexpr (std::is_invocable_v<Func&, Refs&...>) {
+        func(refs...);
+    } else {
+        func(entity);
+    }
+}
+
+//! @brief 同invoke_each, func的第一个参数是Commands&
+template<typename Func, typename ...Refs>
+void invoke_each_with_commands(Func& func, Commands& commands, Entity entity, Refs&... refs) {
+    if constexpr (std::is_invocable_v<Func&, Commands&, Entity, Refs&...>) {
+        func(commands, entity, refs...);
+    } else if constexpr (std::is_invocable_v<Func&, Commands&, Refs&...>) {
+        func(commands, refs...);
+    } else {
+        func(commands, entity);
+    }
+}
+
+//! @brief invoke_each是否把组件传给func, 只接受Entity时组件不会交出去, 遍历不应记为修改
+//! @tparam Args  传给func的组件参数, std::tuple<Refs...>
+template<typename Func, typename Args, bool WithCommands = false>
+struct takes_components;
+
+template<typename Func, typename ...Refs>
+struct takes_components<Func, std::tuple<Refs...>, false> {
+    static constexpr bool value = std::is_invocable_v<Func&, Entity, Refs&...> || std::is_invocable_v<Func&, Refs&...>;
+};
+
+template<typename Func, typename ...Refs>
+struct takes_components<Func, std::tuple<Refs...>, true> {
+    static constexpr bool value = std::is_invocable_v<Func&, Commands&, Entity, Refs&...> || 
+        std::is_invocable_v<Func&, Commands&, Refs&...>;
+};
+
+}  // namespace internal
+
+//! @brief 系统读写的组件和资源, World据此并行调度系统
+//!        两个系统对同一组件(或资源)至少有一方写时冲突, 按注册顺序先后运行, 否则可以同时运行
+//!        只能通过Commands延迟创建/删除的实体和资源不需要声明
+class SystemAccess final {
+public:
+    //! @brief 只读的组件, 系统中只能以const访问: Each/Group/View的条件写 const T, 回调参数是 const T&, 用Get<const T>
+    //!        以非const的T&交给回调或用Get<T>会写入组件的修改tick, 和同时运行的系统产生数据竞争, 这时要声明Write
+    //!        Query, Has, 只接受Entity的Each等不交出组件的访问不写tick, 只读即可
+    template<typename ...ComponentTypes>
+    SystemAccess& Read() {
+        (add(m_readComponents, TypeRegistry<Component>::Get<std::remove_const_t<ComponentTypes>>()), ...);
+        return *this;
+    }
+
+    template<typename ...ComponentTypes>
+    SystemAccess& Write() {
+        (add(m_writeComponents, TypeRegistry<Component>::Get<std::remove_const_t<ComponentTypes>>()), ...);
+        return *this;
+    }
+
+    template<typename ...ResourceTypes>
+    SystemAccess& ReadResource() {
+        (add(m_readResources, TypeRegistry<Resource>::Get<std::remove_const_t<ResourceTypes>>()), ...);
+        return *this;
+    }
+
+    template<typename ...ResourceTypes>
+    SystemAccess& WriteResource() {
+        (add(m_writeResources, TypeRegistry<Resource>::Get<std::remove_const_t<ResourceTypes>>()), ...);
+        return *this;
+    }
+
+    bool Conflict(const SystemAccess& o) const {
+        return overlap(m_writeComponents, o.m_writeComponents) ||
+               overlap(m_writeComponents, o.m_readComponents) ||
+               overlap(m_readComponents, o.m_writeComponents) ||
+               overlap(m_writeResources, o.m_writeResources) ||
+               overlap(m_writeResources, o.m_readResources) ||
+               overlap(m_readResources, o.m_writeResources);
+    }
+
 private:
-    inline static ComponentID m_curIdx = 0;
+    //保持有序, 冲突检查时线性合并
+    static void add(std::vector<ComponentID>& ids, ComponentID id) {
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it == ids.end() || *it != id) {
+            ids.insert(it, id);
+        }
+    }
+
+    static bool overlap(const std::vector<ComponentID>& a, const std::vector<ComponentID>& b) {
+        auto ait = a.begin();
+        auto bit = b.begin();
+        while (ait != a.end() && bit != b.end()) {
+            if (*ait == *bit) {
+                return true;
+            }
+            *ait < *bit ? ++ait : ++bit;
+        }
+        return false;
+    }
+
+    std::vector<ComponentID> m_readComponents;
+    std::vector<ComponentID> m_writeComponents;
+    std::vector<ComponentID> m_readResources;
+    std::vector<ComponentID> m_writeResources;
+};
+
+class EventsBase {
+public:
+    virtual ~EventsBase() = default;
+    virtual void Swap() = 0;
 };
 
-template<typename T, typename = std::enable_if<std::is_integral_v<T>>>
-struct IDGenerator final {
+//! @brief 一种事件的双缓冲通道, 事件按发送顺序编号, 在两块连续的数组中保留两帧
+//!        World::Update的最后交换: 丢弃较旧的一块, 新发送的事件追加到另一块
+//!        两块数组交换时保留容量, 稳定后发送事件不需要分配内存
+template<typename EventType>
+class Events final : public EventsBase {
 public:
-    static T Gen() {
-        return ++m_curId;
+    //! @brief 追加事件, src会被清空(保留容量)
+    void Append(std::vector<EventType>& src) {
+        m_newer.insert(m_newer.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+        src.clear();
+    }
+
+    void Swap() override {
+        m_older.clear();
+        std::swap(m_older, m_newer);
+        m_olderStart = m_newerStart;
+        m_newerStart = m_olderStart + m_older.size();
     }
+
+    const std::vector<EventType>& Older() const { return m_older; }
+    const std::vector<EventType>& Newer() const { return m_newer; }
+    uint64_t OlderStart() const { return m_olderStart; }
+    uint64_t NewerStart() const { return m_newerStart; }
+    //! @brief 下一个事件的编号
+    uint64_t End() const { return m_newerStart + m_newer.size(); }
+
 private:
-    inline static T m_curId = {};
+    std::vector<EventType> m_older;
+    std::vector<EventType> m_newer;
+    uint64_t m_olderStart {0}; //m_older[0]的编号
+    uint64_t m_newerStart {0};
 };
 
-using EntityGenerator = IDGenerator<Entity>;
+//! @brief 一个系统还没有读过的事件, 按发送顺序遍历两块缓冲, 不拷贝事件
+template<typename EventType>
+class EventReader final {
+public:
+    class Iterator final {
+    public:
+        using value_type = EventType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const EventType*;
+        using reference = const EventType&;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const EventReader* reader, size_t index) : m_reader(reader), m_index(index) {}
+
+        const EventType& operator*() const { return (*m_reader)[m_index]; }
+        const EventType* operator->() const { return &(*m_reader)[m_index]; }
+
+        Iterator& operator++() {
+            ++m_index;
+            return *this;
+        }
 
-class Commands;
-class Queryer;
+        Iterator operator++(int) {
+            Iterator copy = *this;
+            ++m_index;
+            return copy;
+        }
 
-using FStartUpSystem = void(*)(Commands&, Queryer&);
-using FSystem = void(*)(Commands&, Queryer&);
+        bool operator==(const Iterator& o) const { return m_index == o.m_index; }
+        bool operator!=(const Iterator& o) const { return m_index != o.m_index; }
+
+    private:
+        const EventReader* m_reader {nullptr};
+        size_t m_index {0};
+    };
+
+    EventReader() = default;
+    EventReader(const EventType* first, size_t firstCount, const EventType* second, size_t secondCount)
+        : m_first(first), m_firstCount(firstCount), m_second(second), m_secondCount(secondCount) {}
+
+    const EventType& operator[](size_t index) const {
+        return index < m_firstCount ? m_first[index] : m_second[index - m_firstCount];
+    }
+
+    size_t size() const { return m_firstCount + m_secondCount; }
+    bool empty() const { return size() == 0; }
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, size()); }
+
+private:
+    const EventType* m_first {nullptr};
+    size_t m_firstCount {0};
+    const EventType* m_second {nullptr};
+    size_t m_secondCount {0};
+};
+
+//组件的存储方式
+enum class StorageMode {
+    SparseSet, //每种组件一个稀疏集, 默认
+    Archetype, //组件集合相同的实体放在同一张表里, 按列存储
+};
 
 struct World final {
 public:
     friend class Commands;
     friend class Queryer;
+    template<typename ...QueryTerms>
+    friend class QueryView;
+    template<typename ...ComponentTypes>
+    friend class GroupView;
 
-    using ComponentContainer = std::unordered_map<ComponentID, void*>;
+    using ComponentContainer = std::vector<ComponentID>;
 
 public:
     World(World&) = delete;
     World& operator=(World&) = delete;
     World() = default;
-    World& operator=(World&&) = default;
+    explicit World(StorageMode storageMode) : m_storageMode(storageMode) {}
+    //原子计数器不能移动, Commands和Queryer也持有World的引用
+    World& operator=(World&&) = delete;
     ~World() { Shutdown(); }
 
     World& AddStartUpSystem(FStartUpSystem _system) {
         m_startUpSystems.emplace_back(_system);
         return *this;
     }
+    //! @brief 注册没有声明读写的系统, 它和其它所有系统冲突, 单独运行
     World& AddSystem(FSystem _system) {
-        m_systems.emplace_back(_system);
+        m_systems.emplace_back(_system, SystemAccess(), true, createCommands());
+        m_scheduleDirty = true;
+        return *this;
+    }
+    //! @brief 注册声明了读写的系统, 和它不冲突的系统在Update中并行运行
+    World& AddSystem(FSystem _system, SystemAccess access) {
+        m_systems.emplace_back(_system, std::move(access), false, createCommands());
+        m_scheduleDirty = true;
         return *this;
     }
     World& RemoveSystem(FSystem _system) {
-        auto it = std::find(m_systems.begin(), m_systems.end(), _system);
+        auto it = std::find_if(m_systems.begin(), m_systems.end(), [_system](const SystemInfo& info) {
+            return info.m_system == _system;
+        });
         if (it == m_systems.end()) {
             assertm("system not registe", false);
         }
-        std::swap(*it, m_systems.back());
-        m_systems.pop_back();
+        //保持注册顺序, 冲突的系统按这个顺序运行
+        m_systems.erase(it);
+        m_scheduleDirty = true;
+        return *this;
+    }
+
+    //! @brief 运行系统和ParEach的线程数(包括调用线程), 0表示硬件线程数, 1表示不并行
+    World& SetThreadCount(size_t count) {
+        m_threadCount = count;
+        m_threadPool.reset();
+        return *this;
+    }
+
+    //! @brief 设置组件稀疏集的页大小(2的幂, 不超过4096, 默认1024), StorageMode::Archetype 下无效
+    //!        页只在有实体写入时才分配, 只有少数分散的实体拥有的组件用小页更省内存; 已有实体时按新的页大小重建
+    template<typename ComponentType>
+    World& SetPageSize(size_t pageSize) {
+        if (m_storageMode == StorageMode::Archetype) {
+            return *this;
+        }
+        assureComponent<std::remove_const_t<ComponentType>>().m_sparseSet->set_page_size(pageSize);
+        return *this;
+    }
+
+    //! @brief 注册一个持久的group, 组内实体在每个组件的存储中排在最前面且顺序一致,
+    //!        遍历 Queryer::Group<ComponentTypes...>() 不需要任何contain检查
+    //!        一个组件只能属于一个group, StorageMode::Archetype 下无需注册
+    template<typename ...ComponentTypes>
+    World& AddGroup() {
+        static_assert(sizeof...(ComponentTypes) > 0, "group need at least one component");
+        if (m_storageMode == StorageMode::Archetype) {
+            return *this;
+        }
+
+        int32_t groupIdx = static_cast<int32_t>(m_groups.size());
+        GroupInfo group;
+        ([&]() {
+            ComponentInfo& info = assureComponent<std::remove_const_t<ComponentTypes>>();
+            assertm("component already owned by another group", info.m_group < 0);
+            info.m_group = groupIdx;
+            group.m_sets.push_back(info.m_sparseSet.get());
+        }(), ...);
+        m_groups.push_back(std::move(group));
+
+        //把已经存在的实体加入group
+        GroupInfo& added = m_groups.back();
+        SparseSet* smallest = *std::min_element(added.m_sets.begin(), added.m_sets.end(), 
+            [](SparseSet* a, SparseSet* b) {
+                return a->size() < b->size();
+            });
+        std::vector<Entity> entities(smallest->packed().begin(), smallest->packed().end());
+        for (Entity entity : entities) {
+            enterGroup(added, entity);
+        }
+        return *this;
+    }
+
+    //! @brief 按组件的值排序, 之后Each/Group按compare的顺序遍历拥有该组件的实体, 不能在Update中调用
+    //!        StorageMode::SparseSet 下组件和ticks随实体一起移动; 属于group时组内外分别排序, 各自有序, 组内其它组件跟着移动
+    //!        StorageMode::Archetype 下分别排序每张含有该组件的表, 每张表内有序
+    //! @param compare  bool(const ComponentType&, const ComponentType&)
+    template<typename ComponentType, typename Compare>
+    World& Sort(Compare compare) {
+        using Type = std::remove_const_t<ComponentType>;
+        ComponentID componentId = TypeRegistry<Component>::Get<Type>();
+        ComponentInfo* info = findComponent(componentId);
+        if (!info) {
+            return *this;
+        }
+        if (m_storageMode == StorageMode::Archetype) {
+            for (auto& archetype : m_archetypes) {
+                internal::column* column = archetype.column(componentId);
+                if (!column) {
+                    continue;
+                }
+                const auto& data = static_cast<internal::typed_column<Type>*>(column)->data;
+                archetype.sort([&data, &compare](size_t lhs, size_t rhs) {
+                    return compare(data[lhs], data[rhs]);
+                });
+                for (size_t row = 0; row < archetype.size(); row++) {
+                    m_entities[internal::entity_id(archetype.entities()[row])].m_row = static_cast<uint32_t>(row);
+                }
+            }
+            return *this;
+        }
+        const Pool<Type>& pool = info->pool<Type>();
+        reorderSet(*info, [&pool, &compare](SparseSet& set, size_t first, size_t last) {
+            set.sort(first, last, [&pool, &compare](Entity lhs, Entity rhs) {
+                return compare(pool.get(lhs), pool.get(rhs));
+            });
+        });
+        return *this;
+    }
+
+    //! @brief 让ComponentType的存储中同时拥有OtherType的实体按OtherType的顺序排在最先遍历的位置,
+    //!        之后遍历两个组件时按内存顺序同步前进, 不能在Update中调用
+    //!        属于group时组内外分别排序; StorageMode::Archetype 下同一实体的组件本来就在同一行, 无需排序
+    template<typename ComponentType, typename OtherType>
+    World& Respect() {
+        if (m_storageMode == StorageMode::Archetype) {
+            return *this;
+        }
+        ComponentInfo* info = findComponent(TypeRegistry<Component>::Get<std::remove_const_t<ComponentType>>());
+        ComponentInfo* other = findComponent(TypeRegistry<Component>::Get<std::remove_const_t<OtherType>>());
+        if (!info || !other) {
+            return *this;
+        }
+        const SparseSet& otherSet = *other->m_sparseSet;
+        reorderSet(*info, [&otherSet](SparseSet& set, size_t first, size_t last) {
+            set.respect(otherSet, first, last);
+        });
         return *this;
     }
 
-    void StartUp();
+    void StartUp();
+
+    //! @brief 运行所有系统, 然后执行它们记录的命令
+    //!        命令的执行顺序是确定的, 和系统在哪个线程上运行无关:
+    //!        1. 依次执行所有缓冲的销毁实体, 销毁资源, 创建实体, 增删组件, 创建资源, 一个阶段完成后才开始下一个
+    //!        2. 每个阶段内先执行StartUp的缓冲, 再按系统注册顺序执行每个系统的缓冲
+    //!        3. 一个系统内按记录顺序执行, ParEach中记录的命令按块的顺序插入到ParEach调用的位置
+    //!        Spawn的实体ID在执行时按上面的顺序分配, 可以复现;
+    //!        SpawnAndReturn立即分配ID, 并行的系统同时调用时ID的分配顺序取决于线程调度
+    //!        4. 最后交换所有事件通道, 再按2, 3的顺序追加这一帧发送的事件, 下一帧起所有系统都能读到
+    void Update();
+
+    //! @brief 立即销毁所有实体, 保留组件, group, archetype表, 资源和系统
+    //!        直接清空每个存储(保留容量), 不逐个删除, 不能在Update中调用
+    void Clear() {
+        for (auto& info : m_componentInfos) {
+            if (info.m_sparseSet) {
+                info.m_sparseSet->clear();
+            }
+        }
+        for (auto& group : m_groups) {
+            group.m_size = 0;
+        }
+        for (auto& archetype : m_archetypes) {
+            archetype.clear();
+        }
+        int64_t cursor = std::max<int64_t>(m_freeCursor.load(std::memory_order_relaxed), 0);
+        m_freeEntities.resize(static_cast<size_t>(cursor));
+        for (auto& entityInfo : m_entities) {
+            if (entityInfo.m_entity != null_entity) {
+                m_freeEntities.push_back(internal::entity_inc_version(entityInfo.m_entity));
+                entityInfo.m_signature = 0;
+                entityInfo.m_entity = null_entity;
+            }
+        }
+        m_freeCursor.store(static_cast<int64_t>(m_freeEntities.size()), std::memory_order_relaxed);
+    }
+
+    //! @brief 释放存储多余的容量, 以及实体都已删除的稀疏页, 不能在Update中调用
+    void ShrinkToFit() {
+        for (auto& info : m_componentInfos) {
+            if (info.m_sparseSet) {
+                info.m_sparseSet->shrink_to_fit();
+            }
+        }
+    }
+
+    void Shutdown() {
+        m_entities.clear();
+        m_freeEntities.clear();
+        m_freeCursor = 0;
+        m_nextEntityId = 0;
+
+        m_archetypes.clear();
+        m_archetypeIndex.clear();
+        m_archetypeEdges.clear();
+        m_signatures.assign(1, ComponentContainer{});
+        m_signatureIndex = {{ComponentContainer{}, 0}};
+        m_signatureEdges.clear();
+        m_lastSignature = 0;
+
+        m_groups.clear();
+        m_componentInfos.clear();
+
+        //先析构资源再释放槽
+        m_resources.clear();
+        m_resourceSlots.clear();
+        m_events.clear();
+
+        m_startUpSystems.clear();
+        m_startUpCommands.reset();
+        m_systems.clear();
+        m_scheduleDirty = true;
+        m_threadPool.reset();
+    }
+
+private:
+    std::vector<FStartUpSystem> m_startUpSystems;
+    std::shared_ptr<Commands> m_startUpCommands;
+
+    struct SystemInfo {
+        FSystem m_system;
+        SystemAccess m_access;
+        bool m_exclusive; //没有声明读写
+        std::shared_ptr<Commands> m_commands; //系统独占的命令缓冲, 并行运行时不需要加锁
+
+        //依赖图: 注册在后且和它冲突的系统, 以及注册在前且和它冲突的系统个数
+        std::vector<size_t> m_dependents;
+        size_t m_dependencyCount {0};
+
+        Tick m_lastRunTick {0}; //上次运行时的tick, Added/Changed和它比较
+        std::vector<uint64_t> m_eventCursors; //按事件ID索引, 下一个要读的事件编号
+
+        SystemInfo(FSystem system, SystemAccess access, bool exclusive, std::shared_ptr<Commands> commands)
+            : m_system(system), m_access(std::move(access)), m_exclusive(exclusive), m_commands(std::move(commands)) {}
+    };
+    std::vector<SystemInfo> m_systems;
+    bool m_scheduleDirty {true};
+    bool m_parallel {false}; //依赖图中是否有可以同时运行的系统
+
+    size_t m_threadCount {0};
+    std::unique_ptr<thread_pool> m_threadPool;
+
+    //变更检测的时钟, 每个系统每次运行和每次执行命令都取一个新的tick
+    //并行的系统同时取, 依赖的系统一定在被依赖的系统之后取到
+    std::atomic<Tick> m_tick {1};
+    Tick m_commandTick {1}; //正在执行的命令写入组件的tick
+
+    Tick nextTick() {
+        return m_tick.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    void buildSchedule();
+    thread_pool* assureThreadPool();
+    void runSystem(SystemInfo& info);
+    void runSystems();
+    void executeCommands();
+
+private:
+    //Entity and Component
+    //默认的稀疏页大小, 4KB一页; 页是单独分配的, 太小的页在遍历时局部性差, 可以用SetPageSize按组件调整
+    static constexpr size_t DefaultPageSize = 1024;
+
+    using SparseSet = basic_sparse_set<Entity, DefaultPageSize>;
+
+    template<typename ComponentType>
+    using Pool = basic_storage<Entity, ComponentType, DefaultPageSize>;
+
+    using Archetype = basic_archetype<Entity, ComponentID>;
+
+    //m_createColumn为空表示组件还没有创建
+    struct ComponentInfo{
+        using CreateColumnFunc = std::unique_ptr<internal::column>(*)(void);
+
+        std::unique_ptr<SparseSet> m_sparseSet; //StorageMode::SparseSet
+        CreateColumnFunc m_createColumn {nullptr}; //StorageMode::Archetype
+        int32_t m_group {-1}; //拥有该组件的group, 一个组件最多属于一个group
+
+        ComponentInfo() = default;
+        ComponentInfo(const ComponentInfo&) = delete;
+        ComponentInfo& operator=(const ComponentInfo&) = delete;
+        ComponentInfo(ComponentInfo&&) = default;
+        ComponentInfo& operator=(ComponentInfo&&) = default;
+
+        ComponentInfo(std::unique_ptr<SparseSet> sparseSet, CreateColumnFunc createColumn) 
+            : m_sparseSet(std::move(sparseSet)), m_createColumn(createColumn) { }
+
+        template<typename ComponentType>
+        Pool<ComponentType>& pool() {
+            return static_cast<Pool<ComponentType>&>(*m_sparseSet);
+        }
+    };
+
+    //按组件ID索引, 只在执行命令时创建, 系统运行时只读
+    //扩容会移动ComponentInfo, 不要跨assureComponent保存它的引用, 稀疏集本身的地址不变
+    std::vector<ComponentInfo> m_componentInfos;
+
+    template<typename ComponentType>
+    ComponentInfo& assureComponent() {
+        ComponentID componentId = TypeRegistry<Component>::Get<ComponentType>();
+        if (componentId >= m_componentInfos.size()) {
+            m_componentInfos.resize(componentId + 1);
+        }
+        ComponentInfo& info = m_componentInfos[componentId];
+        if (!info.m_createColumn) {
+            std::unique_ptr<SparseSet> pool;
+            if (m_storageMode == StorageMode::SparseSet) {
+                pool = std::make_unique<Pool<ComponentType>>();
+            }
+            info = ComponentInfo(
+                std::move(pool),
+                []() -> std::unique_ptr<internal::column> {
+                    return std::make_unique<internal::typed_column<ComponentType>>();
+                });
+        }
+        return info;
+    }
+
+    //! @brief 组件信息, 组件还没有创建时返回nullptr
+    ComponentInfo* findComponent(ComponentID componentId) {
+        if (componentId >= m_componentInfos.size() || !m_componentInfos[componentId].m_createColumn) {
+            return nullptr;
+        }
+        return &m_componentInfos[componentId];
+    }
+
+    //StorageMode::SparseSet, 组内的实体排在每个组件稀疏集的最前面[0, m_size)
+    //且在各个稀疏集中的位置相同
+    struct GroupInfo {
+        std::vector<SparseSet*> m_sets;
+        size_t m_size {0};
+    };
+    std::vector<GroupInfo> m_groups;
+
+    //实体拥有组内所有组件后调用, 把它换到组的末尾
+    void enterGroup(GroupInfo& group, Entity entity) {
+        for (SparseSet* set : group.m_sets) {
+            if (!set->contain(entity)) {
+                return;
+            }
+        }
+        if (group.m_sets[0]->index(entity) < group.m_size) {
+            return;
+        }
+        for (SparseSet* set : group.m_sets) {
+            set->pump(entity, set->packed()[group.m_size]);
+        }
+        group.m_size++;
+    }
+
+    //实体失去组内任一组件前调用, 把它移出组
+    void leaveGroup(GroupInfo& group, Entity entity) {
+        SparseSet* first = group.m_sets[0];
+        if (!first->contain(entity) || first->index(entity) >= group.m_size) {
+            return;
+        }
+        group.m_size--;
+        for (SparseSet* set : group.m_sets) {
+            set->pump(entity, set->packed()[group.m_size]);
+        }
+    }
+
+    //重排组件的稀疏集, reorder(set, first, last)只能移动packed中[first, last)的实体
+    //属于group时组内外分别重排, 然后group的其它稀疏集按它对齐
+    template<typename Func>
+    void reorderSet(ComponentInfo& info, Func&& reorder) {
+        SparseSet& set = *info.m_sparseSet;
+        if (info.m_group < 0) {
+            reorder(set, 0, set.size());
+            return;
+        }
+        GroupInfo& group = m_groups[info.m_group];
+        reorder(set, group.m_size, set.size());
+        reorder(set, 0, group.m_size);
+        for (SparseSet* other : group.m_sets) {
+            if (other == &set) {
+                continue;
+            }
+            for (size_t i = 0; i < group.m_size; i++) {
+                if (other->packed()[i] != set.packed()[i]) {
+                    other->pump(set.packed()[i], other->packed()[i]);
+                }
+            }
+        }
+    }
+
+    template<typename Func>
+    void forEachGroup(const ComponentContainer& components, Func&& func) {
+        for (ComponentID componentId : components) {
+            ComponentInfo* info = findComponent(componentId);
+            if (info && info->m_group >= 0) {
+                func(m_groups[info->m_group]);
+            }
+        }
+    }
+
+    struct EntityInfo {
+        Entity m_entity = null_entity; //当前存活的实体(带版本号), 未使用时为null_entity
+        uint32_t m_signature {0}; //StorageMode::SparseSet 拥有的组件, m_signatures的下标
+        uint32_t m_archetype {0}; //StorageMode::Archetype 所在的表和行
+        uint32_t m_row {0};
+    };
+
+    //按实体ID索引, 回收的ID复用原来的槽位
+    std::vector<EntityInfo> m_entities;
+
+    bool isAlive(Entity entity) const {
+        auto id = internal::entity_id(entity);
+        return id < m_entities.size() && m_entities[id].m_entity == entity;
+    }
+
+    //回收的实体, 版本号已经加一, 优先复用它们的ID
+    //并行的系统会同时创建实体: [0, m_freeCursor) 是还没有被取走的部分, 用原子操作从尾部取,
+    //m_freeEntities本身只在执行命令时(单线程)修改
+    std::vector<Entity> m_freeEntities;
+    std::atomic<int64_t> m_freeCursor {0};
+    std::atomic<Entity> m_nextEntityId {0};
+
+    Entity createEntity() {
+        int64_t cursor = m_freeCursor.fetch_sub(1, std::memory_order_relaxed);
+        if (cursor > 0) {
+            return m_freeEntities[cursor - 1];
+        }
+        using traits = internal::entity_traits<Entity>;
+        Entity id = m_nextEntityId.fetch_add(1, std::memory_order_relaxed);
+        if (id >= traits::entity_mask) {
+            entityIdExhausted();
+        }
+        return internal::construct_entity<Entity>(0, id);
+    }
+
+    //ID用完后再分配会回绕到存活的实体上, Release下也不能继续运行
+    [[noreturn]] static void entityIdExhausted() {
+        std::fputs("cppecs: entity id exhausted\n", stderr);
+        std::abort();
+    }
+
+    //执行命令时(单线程)一次分配count个实体, 先用回收的, 剩下的是连续的新ID
+    void createEntities(Entity* entities, size_t count) {
+        int64_t cursor = std::max<int64_t>(m_freeCursor.load(std::memory_order_relaxed), 0);
+        size_t reuse = std::min(static_cast<size_t>(cursor), count);
+        for (size_t i = 0; i < reuse; i++) {
+            entities[i] = m_freeEntities[--cursor];
+        }
+        m_freeCursor.store(cursor, std::memory_order_relaxed);
+
+        using traits = internal::entity_traits<Entity>;
+        Entity first = m_nextEntityId.fetch_add(static_cast<Entity>(count - reuse), std::memory_order_relaxed);
+        if (first + (count - reuse) > traits::entity_mask) {
+            entityIdExhausted();
+        }
+        for (size_t i = reuse; i < count; i++) {
+            entities[i] = internal::construct_entity<Entity>(0, static_cast<Entity>(first + (i - reuse)));
+        }
+    }
+
+    void releaseEntity(Entity entity) {
+        //丢掉已经被取走的实体
+        int64_t cursor = std::max<int64_t>(m_freeCursor.load(std::memory_order_relaxed), 0);
+        m_freeEntities.resize(static_cast<size_t>(cursor));
+        m_freeEntities.push_back(internal::entity_inc_version(entity));
+        m_freeCursor.store(static_cast<int64_t>(m_freeEntities.size()), std::memory_order_relaxed);
+    }
+
+    StorageMode m_storageMode {StorageMode::SparseSet};
+
+    //StorageMode::Archetype, m_archetypeIndex的key是排好序的组件ID
+    std::vector<Archetype> m_archetypes;
+    std::map<ComponentContainer, uint32_t> m_archetypeIndex;
+
+    //增删一个组件后实体所在的表, 按组件ID缓存, 同一种增删只查找一次m_archetypeIndex
+    struct ArchetypeEdges {
+        std::unordered_map<ComponentID, uint32_t> m_insert;
+        std::unordered_map<ComponentID, uint32_t> m_remove;
+    };
+    std::vector<ArchetypeEdges> m_archetypeEdges; //和m_archetypes一一对应
+
+    uint32_t archetypeAfterChange(uint32_t archetypeIdx, ComponentID componentId, bool insert) {
+        if (m_archetypeEdges.size() < m_archetypes.size()) {
+            m_archetypeEdges.resize(m_archetypes.size());
+        }
+        auto& edges = insert ? m_archetypeEdges[archetypeIdx].m_insert : m_archetypeEdges[archetypeIdx].m_remove;
+        auto it = edges.find(componentId);
+        if (it != edges.end()) {
+            return it->second;
+        }
+
+        uint32_t target = assureArchetype(changeComponents(m_archetypes[archetypeIdx].components(), componentId, insert));
+        edges.emplace(componentId, target);
+        return target;
+    }
+
+    uint32_t assureArchetype(const ComponentContainer& components) {
+        auto it = m_archetypeIndex.find(components);
+        if (it != m_archetypeIndex.end()) {
+            return it->second;
+        }
+
+        std::vector<Archetype::column_ptr> columns;
+        columns.reserve(components.size());
+        for (ComponentID componentId : components) {
+            ComponentInfo* info = findComponent(componentId);
+            assertm("componentInfo not create", info != nullptr);
+            columns.push_back(info->m_createColumn());
+        }
+        uint32_t archetypeIdx = static_cast<uint32_t>(m_archetypes.size());
+        m_archetypes.emplace_back(components, std::move(columns));
+        m_archetypeIndex.emplace(components, archetypeIdx);
+        return archetypeIdx;
+    }
+
+    //StorageMode::SparseSet, 组件集合相同的实体共享一个排好序的组件ID数组, 0是空集合
+    //StorageMode::Archetype 下表本身就是组件集合, 不使用
+    std::vector<ComponentContainer> m_signatures {ComponentContainer{}};
+    std::map<ComponentContainer, uint32_t> m_signatureIndex {{ComponentContainer{}, 0}};
+    std::vector<ArchetypeEdges> m_signatureEdges; //和m_signatures一一对应
+
+    //! @brief 实体拥有的组件, 排好序
+    const ComponentContainer& componentsOf(const EntityInfo& entityInfo) const {
+        if (m_storageMode == StorageMode::Archetype) {
+            return m_archetypes[entityInfo.m_archetype].components();
+        }
+        return m_signatures[entityInfo.m_signature];
+    }
+
+    uint32_t signatureAfterChange(uint32_t signature, ComponentID componentId, bool insert) {
+        if (m_signatureEdges.size() < m_signatures.size()) {
+            m_signatureEdges.resize(m_signatures.size());
+        }
+        auto& edges = insert ? m_signatureEdges[signature].m_insert : m_signatureEdges[signature].m_remove;
+        auto it = edges.find(componentId);
+        if (it != edges.end()) {
+            return it->second;
+        }
+        uint32_t target = assureSignature(changeComponents(m_signatures[signature], componentId, insert));
+        edges.emplace(componentId, target);
+        return target;
+    }
+
+    //连续创建的实体通常组件相同, 先和上一次的结果比较, 不用每次查找m_signatureIndex
+    uint32_t m_lastSignature {0};
+
+    uint32_t assureSignature(const ComponentContainer& components) {
+        if (m_signatures[m_lastSignature] == components) {
+            return m_lastSignature;
+        }
+        auto it = m_signatureIndex.find(components);
+        if (it != m_signatureIndex.end()) {
+            return m_lastSignature = it->second;
+        }
+        uint32_t signature = static_cast<uint32_t>(m_signatures.size());
+        m_signatures.push_back(components);
+        m_signatureIndex.emplace(components, signature);
+        return m_lastSignature = signature;
+    }
+
+    //排好序的组件集合增加或删除一个组件
+    static ComponentContainer changeComponents(const ComponentContainer& src, ComponentID componentId, bool insert) {
+        ComponentContainer components = src;
+        auto pos = std::lower_bound(components.begin(), components.end(), componentId);
+        if (insert) {
+            components.insert(pos, componentId);
+        } else {
+            components.erase(pos);
+        }
+        return components;
+    }
+
+    //Resource, 按资源ID索引, 只在执行命令时创建和销毁, 系统运行时只读
+    //小的资源直接放在分页的槽里, 页不会移动, 所以资源的地址在销毁前不变; 大的资源单独new
+    static constexpr size_t ResourceSlotSize = 64;
+    static constexpr size_t ResourceSlotPageSize = 32;
+
+    struct alignas(std::max_align_t) ResourceSlot {
+        std::byte m_data[ResourceSlotSize];
+    };
+
+    template<typename Type>
+    static constexpr bool IsInlineResource = sizeof(Type) <= ResourceSlotSize && alignof(Type) <= alignof(std::max_align_t);
+
+    //资源类型相关的操作, 每种资源一份
+    struct ResourceOps {
+        //把待创建的资源放进槽里, 返回资源的地址; 大的资源直接返回pending
+        void* (*m_moveTo)(void* slot, void* pending);
+        //销毁已创建的资源
+        void (*m_destroy)(void* resource);
+        //销毁没有执行的命令里待创建的资源
+        void (*m_discard)(void* pending);
+    };
+
+    template<typename Type>
+    static const ResourceOps& resourceOps() {
+        static const ResourceOps ops {
+            [](void* slot, void* pending) -> void* {
+                if constexpr (IsInlineResource<Type>) {
+                    Type* resource = new (slot) Type(std::move(*(Type*)pending));
+                    delete (Type*)pending;
+                    return resource;
+                } else {
+                    return pending;
+                }
+            },
+            [](void* resource) {
+                if constexpr (IsInlineResource<Type>) {
+                    ((Type*)resource)->~Type();
+                } else {
+                    delete (Type*)resource;
+                }
+            },
+            [](void* pending) {
+                delete (Type*)pending;
+            },
+        };
+        return ops;
+    }
+
+    struct ResourceInfo {
+        void* resource{nullptr};
+        const ResourceOps* m_ops{nullptr};
+
+        ResourceInfo() = default;
+        ResourceInfo(const ResourceInfo&) = delete;
+        ResourceInfo& operator=(const ResourceInfo&) = delete;
+        ResourceInfo(ResourceInfo&& o) noexcept : resource(std::exchange(o.resource, nullptr)), m_ops(o.m_ops) {}
+        ResourceInfo& operator=(ResourceInfo&& o) noexcept {
+            if (this != &o) {
+                Reset();
+                resource = std::exchange(o.resource, nullptr);
+                m_ops = o.m_ops;
+            }
+            return *this;
+        }
+        ~ResourceInfo() { Reset(); }
+
+        void Reset() {
+            if (resource) {
+                m_ops->m_destroy(resource);
+            }
+            resource = nullptr;
+        }
+    };
+
+    std::vector<ResourceInfo> m_resources;
+    std::vector<std::unique_ptr<ResourceSlot[]>> m_resourceSlots;
+
+    //资源ID对应的槽, 按需分配整页
+    void* resourceSlot(ComponentID resourceId) {
+        size_t page = resourceId / ResourceSlotPageSize;
+        if (page >= m_resourceSlots.size()) {
+            m_resourceSlots.resize(page + 1);
+        }
+        if (!m_resourceSlots[page]) {
+            m_resourceSlots[page] = std::make_unique<ResourceSlot[]>(ResourceSlotPageSize);
+        }
+        return m_resourceSlots[page][resourceId % ResourceSlotPageSize].m_data;
+    }
+
+    //! @brief 资源的地址, 没有创建时返回nullptr
+    void* findResource(ComponentID resourceId) const {
+        return resourceId < m_resources.size() ? m_resources[resourceId].resource : nullptr;
+    }
+
+    //Event, 按事件ID索引, 只在执行命令时创建, 系统运行时只读
+    std::vector<std::unique_ptr<EventsBase>> m_events;
+
+    template<typename EventType>
+    Events<EventType>& assureEvents() {
+        ComponentID eventId = TypeRegistry<Event>::Get<EventType>();
+        if (eventId >= m_events.size()) {
+            m_events.resize(eventId + 1);
+        }
+        if (!m_events[eventId]) {
+            m_events[eventId] = std::make_unique<Events<EventType>>();
+        }
+        return static_cast<Events<EventType>&>(*m_events[eventId]);
+    }
+
+    template<typename EventType>
+    const Events<EventType>* findEvents() const {
+        ComponentID eventId = TypeRegistry<Event>::Get<EventType>();
+        if (eventId >= m_events.size() || !m_events[eventId]) {
+            return nullptr;
+        }
+        return static_cast<const Events<EventType>*>(m_events[eventId].get());
+    }
+
+private:
+    std::shared_ptr<Commands> createCommands();
+};
+
+//! @brief 延迟执行的命令, 在World::Update的最后统一执行, 执行顺序见World::Update
+//!        每个系统有自己的Commands, 只能在运行该系统的线程上使用;
+//!        ParEach中使用传给回调的Commands, 不要使用系统的Commands
+class Commands final {
+public:
+    friend class World;
+    template<typename ...QueryTerms>
+    friend class QueryView;
+
+private:
+    Commands(World& world) : m_world(world) {}
+public:
+    Commands(const Commands&) = delete;
+    Commands& operator=(const Commands&) = delete;
+    Commands(Commands&&) = default;
+    Commands& operator=(Commands&&) = default;
+    ~Commands() { discardComponents(); }
+    
+public:
+    template<typename ...ComponentTypes>
+    Entity SpawnAndReturn(ComponentTypes&& ...components) {
+        Entity entity = m_world.createEntity();
+        doSpawn(entity, std::forward<ComponentTypes>(components)...);
+        return entity;
+    }
+
+    //! @brief 不返回实体, 实体ID在执行命令时分配
+    template<typename ...ComponentTypes>
+    Commands& Spawn(ComponentTypes&& ...components) {
+        doSpawn(null_entity, std::forward<ComponentTypes>(components)...);
+        return *this;
+    }
+
+    //! @brief 创建count个拥有相同组件的实体, 组件先值初始化, 再调用 init(index, Components&...)
+    //!        执行时一次分配所有实体ID, 预留组件存储和稀疏集的页, 然后在一个循环里写入
+    //!        和Spawn一样在执行时分配实体ID
+    template<typename ...ComponentTypes, typename Init>
+    Commands& SpawnBatch(size_t count, Init&& init) {
+        static_assert(sizeof...(ComponentTypes) > 0, "batch need at least one component");
+        constexpr size_t componentCount = sizeof...(ComponentTypes);
+        ComponentSpawnInfo* componentInfos = m_arena.allocate_array<ComponentSpawnInfo>(componentCount);
+        std::tuple<ComponentTypes*...> arrays;
+        size_t index = 0;
+        ([&]() {
+            using Type = ComponentTypes;
+            static_assert(std::is_same_v<Type, std::decay_t<Type>>, "batch component must be a value type");
+            Type* data = static_cast<Type*>(m_arena.allocate(sizeof(Type) * count, alignof(Type)));
+            std::uninitialized_value_construct_n(data, count);
+            std::get<Type*>(arrays) = data;
+            new (&componentInfos[index++]) ComponentSpawnInfo{
+                TypeRegistry<Component>::Get<Type>(), data, &componentOps<Type>()};
+        }(), ...);
+
+        for (size_t i = 0; i < count; i++) {
+            std::apply([&init, i](auto*... data) { init(i, data[i]...); }, arrays);
+        }
+        m_spawnBatches.push_back(SpawnBatchInfo{m_spawnEntities.size(), count, componentInfos, componentCount});
+        return *this;
+    }
+
+    Commands& Destroy(Entity entity) {
+        m_destroyEntities.push_back(entity);
+        return *this;
+    }
+
+    //! @brief 销毁所有满足条件的实体, 条件同Queryer::Query, 在执行销毁时才查询
+    //!        Added/Changed和记录命令的系统比较, 同它在系统中的Query结果
+    //!        整个存储(或整张archetype表)都被销毁时直接清空, 不逐个删除
+    template<typename ...QueryTerms>
+    Commands& DestroyAll() {
+        m_destroyQueries.push_back(DestroyQueryInfo{m_destroyEntities.size(), m_lastRunTick, m_thisRunTick, 
+            [](Commands& commands, Tick lastRun, Tick thisRun) {
+                commands.destroyAll<QueryTerms...>(lastRun, thisRun);
+            }});
+        return *this;
+    }
+
+    //! @brief 给存活的实体添加组件, 已经有该组件时替换它的值
+    //!        在创建实体之后执行, 可以用于同一帧SpawnAndReturn的实体; 执行时实体已销毁则忽略
+    //!        StorageMode::SparseSet 只修改该组件的存储, StorageMode::Archetype 把实体移到新表
+    template<typename ComponentType>
+    Commands& Insert(Entity entity, ComponentType&& component) {
+        using Type = std::decay_t<ComponentType>;
+        Type* data = m_arena.create<Type>(std::forward<ComponentType>(component));
+        m_changeComponents.push_back(ComponentChangeInfo{
+            entity, ComponentSpawnInfo{TypeRegistry<Component>::Get<Type>(), data, &componentOps<Type>()}, true});
+        return *this;
+    }
+
+    //! @brief 删除实体的组件, 执行时实体没有该组件则忽略, 执行顺序同Insert
+    template<typename ComponentType>
+    Commands& Remove(Entity entity) {
+        using Type = std::remove_const_t<ComponentType>;
+        m_changeComponents.push_back(ComponentChangeInfo{
+            entity, ComponentSpawnInfo{TypeRegistry<Component>::Get<Type>(), nullptr, &componentOps<Type>()}, false});
+        return *this;
+    }
+
+    //! @brief 设置资源, 执行命令时才放进World, 返回的引用只在执行命令前有效
+    template<typename ComponentType>
+    std::decay_t<ComponentType>& SetResource(ComponentType&& component) {
+        using Type = std::decay_t<ComponentType>;
+        ComponentID componentId = TypeRegistry<Resource>::Get<Type>();
+        //系统可能在并行运行, 这里只读m_resources, ResourceInfo在执行命令时创建
+        assertm("resource already set", m_world.findResource(componentId) == nullptr);
+
+        Type* compData = new Type(std::forward<ComponentType>(component));
+        m_createResources.push_back(ResourceCreateInfo{componentId, compData, &World::resourceOps<Type>()});
+        return *compData;
+    }
+
+    template<typename ComponentType>
+    Commands& RemoveResource() {
+        ComponentID componentId = TypeRegistry<Resource>::Get<ComponentType>();
+        m_destoryResources.push_back(componentId);
+        return *this;
+    }
+
+    //! @brief 发送事件, 先放在这个缓冲的数组里, 执行命令时追加到World的事件通道
+    //!        下一帧起可以用Queryer::ReadEvents读取, 见World::Update
+    template<typename EventType>
+    Commands& SendEvent(EventType&& event) {
+        using Type = std::decay_t<EventType>;
+        assureEventQueue<Type>().m_events.push_back(std::forward<EventType>(event));
+        return *this;
+    }
+
+    //! @brief 依次执行: 销毁实体, 销毁资源, 创建实体, 增删组件, 创建资源, 发送事件
+    //!        World::Update 按阶段合并所有系统的命令, 每个阶段内按系统注册顺序执行
+    void Execute() {
+        m_world.m_commandTick = m_world.nextTick();
+        executeDestroyEntities();
+        executeDestroyResources();
+        executeSpawnEntities();
+        executeChangeComponents();
+        executeCreateResources();
+        executeSendEvents();
+    }
+
+private:
+    void executeDestroyEntities() {
+        //DestroyAll按记录时的位置插在单个销毁之间
+        size_t queryIdx = 0;
+        for (size_t i = 0; i <= m_destroyEntities.size(); i++) {
+            while (queryIdx < m_destroyQueries.size() && m_destroyQueries[queryIdx].m_position == i) {
+                DestroyQueryInfo& query = m_destroyQueries[queryIdx++];
+                query.m_destroy(*this, query.m_lastRun, query.m_thisRun);
+            }
+            if (i < m_destroyEntities.size()) {
+                destroyEntity(m_destroyEntities[i]);
+            }
+        }
+        m_destroyEntities.clear();
+        m_destroyQueries.clear();
+    }
+
+    void executeDestroyResources() {
+        for (auto& componentId : m_destoryResources) {
+            destroyResource(componentId);
+        }
+        m_destoryResources.clear();
+    }
+
+    void executeSpawnEntities() {
+        //批量创建按记录时的位置插在单个创建之间
+        size_t batchIdx = 0;
+        for (size_t i = 0; i <= m_spawnEntities.size(); i++) {
+            while (batchIdx < m_spawnBatches.size() && m_spawnBatches[batchIdx].m_position == i) {
+                doSpawnBatch(m_spawnBatches[batchIdx++]);
+            }
+            if (i < m_spawnEntities.size()) {
+                doSpawnWithoutType(m_spawnEntities[i]);
+            }
+        }
+        m_spawnEntities.clear();
+        m_spawnBatches.clear();
+    }
+
+    //按记录顺序执行, 这是最后一个使用arena的阶段
+    void executeChangeComponents() {
+        for (auto& changeInfo : m_changeComponents) {
+            if (changeInfo.m_insert) {
+                insertComponent(changeInfo.m_entity, changeInfo.m_component);
+            } else {
+                removeComponent(changeInfo.m_entity, changeInfo.m_component.m_componentId);
+            }
+        }
+        m_changeComponents.clear();
+        resetArena();
+    }
+
+    //合并进来的命令可能在子缓冲的arena中, 一起重置
+    void resetArena() {
+        m_arena.reset();
+        for (auto& chunk : m_chunkCommands) {
+            chunk->m_arena.reset();
+        }
+    }
+
+    //析构没有执行的命令里的组件
+    void discardComponents() {
+        for (auto& changeInfo : m_changeComponents) {
+            changeInfo.m_component.Discard();
+        }
+        m_changeComponents.clear();
+        for (auto& entitySpawnInfo : m_spawnEntities) {
+            for (auto& componentSpawnInfo : entitySpawnInfo) {
+                componentSpawnInfo.Discard();
+            }
+        }
+        m_spawnEntities.clear();
+        for (auto& batch : m_spawnBatches) {
+            for (auto& componentSpawnInfo : batch) {
+                componentSpawnInfo.DiscardBatch(batch.m_count);
+            }
+        }
+        m_spawnBatches.clear();
+        for (auto& resourceCreateInfo : m_createResources) {
+            resourceCreateInfo.m_ops->m_discard(resourceCreateInfo.m_componentData);
+        }
+        m_createResources.clear();
+    }
+
+    void executeCreateResources() {
+        for (auto& resourceCreateInfo : m_createResources) {
+            createResourceWithoutType(resourceCreateInfo);
+        }
+        m_createResources.clear();
+    }
+
+    void executeSendEvents() {
+        for (auto& queue : m_eventQueues) {
+            if (queue) {
+                queue->SendTo(m_world);
+            }
+        }
+    }
+
+    //每种事件一个数组, 按事件ID索引, 执行后保留容量
+    struct EventQueueBase {
+        virtual ~EventQueueBase() = default;
+        virtual void SendTo(World& world) = 0;
+        virtual void MoveTo(EventQueueBase& dst) = 0;
+        virtual std::unique_ptr<EventQueueBase> CreateEmpty() const = 0;
+    };
+
+    template<typename EventType>
+    struct EventQueue final : public EventQueueBase {
+        std::vector<EventType> m_events;
+
+        void SendTo(World& world) override {
+            if (!m_events.empty()) {
+                world.assureEvents<EventType>().Append(m_events);
+            }
+        }
+
+        void MoveTo(EventQueueBase& dst) override {
+            auto& dstEvents = static_cast<EventQueue&>(dst).m_events;
+            dstEvents.insert(dstEvents.end(), std::make_move_iterator(m_events.begin()), std::make_move_iterator(m_events.end()));
+            m_events.clear();
+        }
+
+        std::unique_ptr<EventQueueBase> CreateEmpty() const override {
+            return std::make_unique<EventQueue>();
+        }
+    };
+
+    template<typename EventType>
+    EventQueue<EventType>& assureEventQueue() {
+        ComponentID eventId = TypeRegistry<Event>::Get<EventType>();
+        if (eventId >= m_eventQueues.size()) {
+            m_eventQueues.resize(eventId + 1);
+        }
+        if (!m_eventQueues[eventId]) {
+            m_eventQueues[eventId] = std::make_unique<EventQueue<EventType>>();
+        }
+        return static_cast<EventQueue<EventType>&>(*m_eventQueues[eventId]);
+    }
+
+    //ParEach每块一个子缓冲, 在调用ParEach的线程上创建
+    Commands& assureChunkCommands(size_t count) {
+        while (m_chunkCommands.size() < count) {
+            m_chunkCommands.emplace_back(new Commands(m_world));
+        }
+        for (size_t i = 0; i < count; i++) {
+            m_chunkCommands[i]->setRunTicks(m_lastRunTick, m_thisRunTick);
+        }
+        return *this;
+    }
+
+    //按块的顺序把子缓冲的命令接到本缓冲后面, 子缓冲保留容量
+    void mergeChunkCommands(size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            Commands& chunk = *m_chunkCommands[i];
+            for (auto& query : chunk.m_destroyQueries) {
+                query.m_position += m_destroyEntities.size();
+            }
+            appendTo(m_destroyQueries, chunk.m_destroyQueries);
+            appendTo(m_destroyEntities, chunk.m_destroyEntities);
+            appendTo(m_destoryResources, chunk.m_destoryResources);
+            for (auto& batch : chunk.m_spawnBatches) {
+                batch.m_position += m_spawnEntities.size();
+            }
+            appendTo(m_spawnBatches, chunk.m_spawnBatches);
+            appendTo(m_spawnEntities, chunk.m_spawnEntities);
+            appendTo(m_changeComponents, chunk.m_changeComponents);
+            appendTo(m_createResources, chunk.m_createResources);
+            if (m_eventQueues.size() < chunk.m_eventQueues.size()) {
+                m_eventQueues.resize(chunk.m_eventQueues.size());
+            }
+            for (size_t eventId = 0; eventId < chunk.m_eventQueues.size(); eventId++) {
+                auto& queue = chunk.m_eventQueues[eventId];
+                if (!queue) {
+                    continue;
+                }
+                if (!m_eventQueues[eventId]) {
+                    m_eventQueues[eventId] = queue->CreateEmpty();
+                }
+                queue->MoveTo(*m_eventQueues[eventId]);
+            }
+        }
+    }
+
+    template<typename T>
+    static void appendTo(std::vector<T>& dst, std::vector<T>& src) {
+        dst.insert(dst.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+        src.clear();
+    }
+
+    //组件类型相关的操作, 每种组件一份
+    struct ComponentOps {
+        //把组件移动到稀疏集, 然后析构arena中的组件, tick是添加的时间
+        void (*m_emplace)(World::ComponentInfo&, Entity, void*, Tick tick);
+        //析构arena中的组件, 内存随arena释放
+        void (*m_destroy)(void*);
+        World::ComponentInfo& (*m_assure)(World&);
+
+        //SpawnBatch: 一次移动count个组件, maxId是这些实体中最大的ID
+        void (*m_emplaceBatch)(World::ComponentInfo&, const Entity*, size_t count, Entity maxId, void*, Tick tick);
+        void (*m_pushBatch)(internal::column&, size_t count, void*);
+        void (*m_destroyBatch)(void*, size_t count);
+
+        //Insert已有的组件: 移动赋值给存储中的组件, 然后析构arena中的组件
+        void (*m_replace)(World::ComponentInfo&, Entity, void*, Tick tick);
+        void (*m_assign)(void* dst, void* elemData);
+    };
+
+    template<typename Type>
+    static const ComponentOps& componentOps() {
+        static const ComponentOps ops {
+            [](World::ComponentInfo& componentInfo, Entity entity, void* elemData, Tick tick) {
+                auto& pool = componentInfo.pool<Type>();
+                pool.emplace(entity, std::move(*(Type*)elemData));
+                pool.ticks().back() = component_ticks{tick, tick};
+                ((Type*)elemData)->~Type();
+            },
+            [](void* elemData) {
+                ((Type*)elemData)->~Type();
+            },
+            [](World& world) -> World::ComponentInfo& {
+                return world.assureComponent<Type>();
+            },
+            [](World::ComponentInfo& componentInfo, const Entity* entities, size_t count, Entity maxId, void* elemData, Tick tick) {
+                auto& pool = componentInfo.pool<Type>();
+                pool.reserve(pool.size() + count);
+                pool.reserve_pages(internal::entity_id(maxId));
+                Type* data = (Type*)elemData;
+                for (size_t i = 0; i < count; i++) {
+                    pool.emplace(entities[i], std::move(data[i]));
+                    pool.ticks().back() = component_ticks{tick, tick};
+                }
+                std::destroy_n(data, count);
+            },
+            [](internal::column& column, size_t count, void* elemData) {
+                auto& columnData = static_cast<internal::typed_column<Type>&>(column).data;
+                Type* data = (Type*)elemData;
+                columnData.insert(columnData.end(), std::make_move_iterator(data), std::make_move_iterator(data + count));
+                std::destroy_n(data, count);
+            },
+            [](void* elemData, size_t count) {
+                std::destroy_n((Type*)elemData, count);
+            },
+            [](World::ComponentInfo& componentInfo, Entity entity, void* elemData, Tick tick) {
+                auto& pool = componentInfo.pool<Type>();
+                pool.get(entity) = std::move(*(Type*)elemData);
+                pool.ticks(entity).changed = tick;
+                ((Type*)elemData)->~Type();
+            },
+            [](void* dst, void* elemData) {
+                *(Type*)dst = std::move(*(Type*)elemData);
+                ((Type*)elemData)->~Type();
+            },
+        };
+        return ops;
+    }
+
+    //记录在m_arena中, 执行后m_componentData为nullptr
+    struct ComponentSpawnInfo {
+        ComponentID m_componentId; 
+        void* m_componentData;
+        const ComponentOps* m_ops;
+
+        //组件信息在执行命令时才创建, 系统并行运行时不修改m_componentInfos
+        World::ComponentInfo& Assure(World& world) {
+            return m_ops->m_assure(world);
+        }
+
+        void Emplace(World::ComponentInfo& componentInfo, Entity entity, Tick tick) {
+            m_ops->m_emplace(componentInfo, entity, m_componentData, tick);
+            m_componentData = nullptr;
+        }
+
+        void MoveTo(internal::column& column) {
+            column.push(m_componentData);
+            m_ops->m_destroy(m_componentData);
+            m_componentData = nullptr;
+        }
+
+        void Replace(World::ComponentInfo& componentInfo, Entity entity, Tick tick) {
+            m_ops->m_replace(componentInfo, entity, m_componentData, tick);
+            m_componentData = nullptr;
+        }
+
+        void AssignTo(void* dst) {
+            m_ops->m_assign(dst, m_componentData);
+            m_componentData = nullptr;
+        }
+
+        void Discard() {
+            if (m_componentData) {
+                m_ops->m_destroy(m_componentData);
+                m_componentData = nullptr;
+            }
+        }
+
+        //SpawnBatch时m_componentData是count个组件的数组
+        void EmplaceBatch(World::ComponentInfo& componentInfo, const Entity* entities, size_t count, Entity maxId, Tick tick) {
+            m_ops->m_emplaceBatch(componentInfo, entities, count, maxId, m_componentData, tick);
+            m_componentData = nullptr;
+        }
+
+        void MoveBatchTo(internal::column& column, size_t count) {
+            m_ops->m_pushBatch(column, count, m_componentData);
+            m_componentData = nullptr;
+        }
+
+        void DiscardBatch(size_t count) {
+            if (m_componentData) {
+                m_ops->m_destroyBatch(m_componentData, count);
+                m_componentData = nullptr;
+            }
+        }
+    };
+    struct EntitySpawnInfo {
+        Entity m_entity; //null_entity 表示执行时再分配
+        ComponentSpawnInfo* m_components; //在m_arena中
+        size_t m_componentCount;
+
+        ComponentSpawnInfo* begin() const { return m_components; }
+        ComponentSpawnInfo* end() const { return m_components + m_componentCount; }
+    };
+    struct SpawnBatchInfo {
+        size_t m_position; //在m_spawnEntities中的位置, 保证和单个创建的先后顺序
+        size_t m_count;
+        ComponentSpawnInfo* m_components; //在m_arena中, 每种组件一个数组
+        size_t m_componentCount;
+
+        ComponentSpawnInfo* begin() const { return m_components; }
+        ComponentSpawnInfo* end() const { return m_components + m_componentCount; }
+    };
+    struct ComponentChangeInfo {
+        Entity m_entity;
+        ComponentSpawnInfo m_component; //Remove时m_componentData为nullptr
+        bool m_insert;
+    };
+
+    //组件和记录都放在m_arena中, 创建实体不需要堆分配
+    template<typename ...ComponentTypes>
+    void doSpawn(Entity entity, ComponentTypes&&... components) {
+        constexpr size_t count = sizeof...(ComponentTypes);
+        ComponentSpawnInfo* componentInfos = m_arena.allocate_array<ComponentSpawnInfo>(count);
+        size_t index = 0;
+        ([&]() {
+            using Type = std::decay_t<ComponentTypes>;
+            Type* data = m_arena.create<Type>(std::forward<ComponentTypes>(components));
+            new (&componentInfos[index++]) ComponentSpawnInfo{
+                TypeRegistry<Component>::Get<Type>(), data, &componentOps<Type>()};
+        }(), ...);
+        m_spawnEntities.push_back(EntitySpawnInfo{entity, componentInfos, count});
+    }
+
+    void doSpawnBatch(SpawnBatchInfo& batch) {
+        size_t count = batch.m_count;
+        if (count == 0) {
+            return;
+        }
+        m_batchEntities.resize(count);
+        Entity* entities = m_batchEntities.data();
+        m_world.createEntities(entities, count);
+        Entity maxId = 0;
+        for (size_t i = 0; i < count; i++) {
+            maxId = std::max<Entity>(maxId, internal::entity_id(entities[i]));
+        }
+        if (maxId >= m_world.m_entities.size()) {
+            m_world.m_entities.resize(maxId + 1);
+        }
+
+        std::sort(batch.begin(), batch.end(), 
+            [](const ComponentSpawnInfo& a, const ComponentSpawnInfo& b) {
+                return a.m_componentId < b.m_componentId;
+            });
+        World::ComponentContainer components;
+        for (auto& componentSpawnInfo : batch) {
+            components.push_back(componentSpawnInfo.m_componentId);
+        }
+
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            for (auto& componentSpawnInfo : batch) {
+                componentSpawnInfo.Assure(m_world);
+            }
+            uint32_t archetypeIdx = m_world.assureArchetype(components);
+            World::Archetype& archetype = m_world.m_archetypes[archetypeIdx];
+            archetype.reserve(archetype.size() + count);
+            component_ticks ticks {m_world.m_commandTick, m_world.m_commandTick};
+            for (size_t i = 0; i < count; i++) {
+                World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entities[i])];
+                entityInfo.m_entity = entities[i];
+                entityInfo.m_archetype = archetypeIdx;
+                entityInfo.m_row = static_cast<uint32_t>(archetype.push(entities[i], ticks));
+            }
+            for (auto& componentSpawnInfo : batch) {
+                componentSpawnInfo.MoveBatchTo(*archetype.column(componentSpawnInfo.m_componentId), count);
+            }
+            return;
+        }
+
+        for (auto& componentSpawnInfo : batch) {
+            componentSpawnInfo.EmplaceBatch(componentSpawnInfo.Assure(m_world), entities, count, maxId, m_world.m_commandTick);
+        }
+        //整批共享一个组件集合
+        uint32_t signature = m_world.assureSignature(components);
+        for (size_t i = 0; i < count; i++) {
+            World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entities[i])];
+            entityInfo.m_entity = entities[i];
+            entityInfo.m_signature = signature;
+        }
+        if (!m_world.m_groups.empty()) {
+            for (size_t i = 0; i < count; i++) {
+                m_world.forEachGroup(components, [this, entity = entities[i]](World::GroupInfo& group) {
+                    m_world.enterGroup(group, entity);
+                });
+            }
+        }
+    }
+
+    void doSpawnWithoutType(EntitySpawnInfo &spawnInfo) {
+        if (spawnInfo.m_entity == null_entity) {
+            spawnInfo.m_entity = m_world.createEntity();
+        }
+        Entity entity = spawnInfo.m_entity;
+        auto id = internal::entity_id(entity);
+        if (id >= m_world.m_entities.size()) {
+            m_world.m_entities.resize(id + 1);
+        }
+        World::EntityInfo& entityInfo = m_world.m_entities[id];
+        entityInfo.m_entity = entity;
+        auto& componentContainer = m_spawnComponents;
+        componentContainer.clear();
+
+        std::sort(spawnInfo.begin(), spawnInfo.end(), 
+            [](const ComponentSpawnInfo& a, const ComponentSpawnInfo& b) {
+                return a.m_componentId < b.m_componentId;
+            });
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            for (auto& componentSpawnInfo : spawnInfo) {
+                componentSpawnInfo.Assure(m_world);
+                componentContainer.push_back(componentSpawnInfo.m_componentId);
+            }
+
+            entityInfo.m_archetype = m_world.assureArchetype(componentContainer);
+            World::Archetype& archetype = m_world.m_archetypes[entityInfo.m_archetype];
+            entityInfo.m_row = static_cast<uint32_t>(archetype.push(entity, {m_world.m_commandTick, m_world.m_commandTick}));
+            for (auto& componentSpawnInfo : spawnInfo) {
+                componentSpawnInfo.MoveTo(*archetype.column(componentSpawnInfo.m_componentId));
+            }
+            return;
+        }
+        for (auto& componentSpawnInfo : spawnInfo) {
+            ComponentID componentId = componentSpawnInfo.m_componentId;
+            World::ComponentInfo& componentInfo = componentSpawnInfo.Assure(m_world);
+
+            componentSpawnInfo.Emplace(componentInfo, entity, m_world.m_commandTick);
+
+            componentContainer.push_back(componentId);
+        }
+        entityInfo.m_signature = m_world.assureSignature(componentContainer);
+
+        if (!m_world.m_groups.empty()) {
+            m_world.forEachGroup(componentContainer, [this, entity](World::GroupInfo& group) {
+                m_world.enterGroup(group, entity);
+            });
+        }
+    }
+
+    void insertComponent(Entity entity, ComponentSpawnInfo& componentSpawnInfo) {
+        if (!m_world.isAlive(entity)) {
+            componentSpawnInfo.Discard();
+            return;
+        }
+        ComponentID componentId = componentSpawnInfo.m_componentId;
+        World::ComponentInfo& componentInfo = componentSpawnInfo.Assure(m_world);
+        World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            internal::column* column = m_world.m_archetypes[entityInfo.m_archetype].column(componentId);
+            if (column) {
+                componentSpawnInfo.AssignTo(column->get(entityInfo.m_row));
+                column->ticks[entityInfo.m_row].changed = m_world.m_commandTick;
+                return;
+            }
+            moveArchetype(entity, componentId, true, &componentSpawnInfo);
+            return;
+        }
+
+        if (componentInfo.m_sparseSet->contain(entity)) {
+            componentSpawnInfo.Replace(componentInfo, entity, m_world.m_commandTick);
+            return;
+        }
+        componentSpawnInfo.Emplace(componentInfo, entity, m_world.m_commandTick);
+        entityInfo.m_signature = m_world.signatureAfterChange(entityInfo.m_signature, componentId, true);
+        if (componentInfo.m_group >= 0) {
+            m_world.enterGroup(m_world.m_groups[componentInfo.m_group], entity);
+        }
+    }
+
+    void removeComponent(Entity entity, ComponentID componentId) {
+        if (!m_world.isAlive(entity)) {
+            return;
+        }
+        World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            if (m_world.m_archetypes[entityInfo.m_archetype].has(componentId)) {
+                moveArchetype(entity, componentId, false, nullptr);
+            }
+            return;
+        }
+
+        World::ComponentInfo* info = m_world.findComponent(componentId);
+        if (!info || !info->m_sparseSet->contain(entity)) {
+            return;
+        }
+        World::ComponentInfo& componentInfo = *info;
+        if (componentInfo.m_group >= 0) {
+            m_world.leaveGroup(m_world.m_groups[componentInfo.m_group], entity);
+        }
+        componentInfo.m_sparseSet->remove(entity);
+        entityInfo.m_signature = m_world.signatureAfterChange(entityInfo.m_signature, componentId, false);
+    }
+
+    //StorageMode::Archetype 把实体移到多(或少)一个组件的表, 其它组件逐列移动, 保留它们的tick
+    void moveArchetype(Entity entity, ComponentID componentId, bool insert, ComponentSpawnInfo* inserted) {
+        World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+        uint32_t srcIdx = entityInfo.m_archetype;
+        //可能创建新表, 先取到下标再引用m_archetypes中的元素
+        uint32_t dstIdx = m_world.archetypeAfterChange(srcIdx, componentId, insert);
+        World::Archetype& src = m_world.m_archetypes[srcIdx];
+        World::Archetype& dst = m_world.m_archetypes[dstIdx];
+
+        uint32_t row = entityInfo.m_row;
+        size_t dstRow = dst.push(entity, {m_world.m_commandTick, m_world.m_commandTick});
+        for (ComponentID dstComponentId : dst.components()) {
+            internal::column& column = *dst.column(dstComponentId);
+            if (insert && dstComponentId == componentId) {
+                inserted->MoveTo(column);
+            } else {
+                internal::column& srcColumn = *src.column(dstComponentId);
+                column.push(srcColumn.get(row));
+                column.ticks[dstRow] = srcColumn.ticks[row];
+            }
+        }
+        Entity moved = src.swap_and_pop(row);
+        if (moved != null_entity) {
+            m_world.m_entities[internal::entity_id(moved)].m_row = row;
+        }
+        entityInfo.m_archetype = dstIdx;
+        entityInfo.m_row = static_cast<uint32_t>(dstRow);
+    }
+
+    struct ResourceCreateInfo{
+        ComponentID m_componentId {0};
+        void* m_componentData {nullptr};
+        const World::ResourceOps* m_ops {nullptr};
+    };
+
+    void createResourceWithoutType(ResourceCreateInfo& info) {
+        ComponentID componentId = info.m_componentId;
+        if (componentId >= m_world.m_resources.size()) {
+            m_world.m_resources.resize(componentId + 1);
+        }
+        World::ResourceInfo& resourceInfo = m_world.m_resources[componentId];
+        assertm("resource already set", resourceInfo.resource == nullptr);
+        resourceInfo.m_ops = info.m_ops;
+        resourceInfo.resource = info.m_ops->m_moveTo(m_world.resourceSlot(componentId), info.m_componentData);
+        info.m_componentData = nullptr;
+    }
+
+    struct DestroyQueryInfo {
+        size_t m_position; //在m_destroyEntities中的位置
+        Tick m_lastRun; //记录时系统的tick窗口
+        Tick m_thisRun;
+        void (*m_destroy)(Commands&, Tick lastRun, Tick thisRun);
+    };
+
+    template<typename ...QueryTerms>
+    void destroyAll(Tick lastRun, Tick thisRun) {
+        using View = QueryView<QueryTerms...>;
+        View view(m_world, lastRun, thisRun);
+        m_bulkEntities.clear();
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            if constexpr (!View::HasTickFilter) {
+                //匹配的表中所有行都满足条件, 整张表清空
+                for (auto& archetype : m_world.m_archetypes) {
+                    if (!view.match(archetype)) {
+                        continue;
+                    }
+                    for (Entity entity : archetype.entities()) {
+                        releaseEntityInfo(entity);
+                    }
+                    archetype.clear();
+                }
+                return;
+            }
+            //Added/Changed要看每一行的tick, 逐个销毁
+            view.each([this](Entity entity) {
+                m_bulkEntities.push_back(entity);
+            });
+            for (Entity entity : m_bulkEntities) {
+                destroyEntity(entity);
+            }
+            return;
+        }
+        view.each([this](Entity entity) {
+            m_bulkEntities.push_back(entity);
+        });
+        destroyEntities(m_bulkEntities);
+    }
+
+    //StorageMode::SparseSet 批量销毁, 实体全部被销毁的存储直接清空
+    void destroyEntities(const std::vector<Entity>& entities) {
+        if (entities.empty()) {
+            return;
+        }
+        //每个存储中有多少个要销毁的实体
+        m_bulkCounts.clear();
+        for (Entity entity : entities) {
+            for (ComponentID componentId : m_world.componentsOf(m_world.m_entities[internal::entity_id(entity)])) {
+                if (componentId >= m_bulkCounts.size()) {
+                    m_bulkCounts.resize(componentId + 1, 0);
+                }
+                m_bulkCounts[componentId]++;
+            }
+        }
+        //清空的存储计数改为0, 后面不再逐个删除
+        for (ComponentID componentId = 0; componentId < m_bulkCounts.size(); componentId++) {
+            size_t& count = m_bulkCounts[componentId];
+            if (count == 0) {
+                continue;
+            }
+            World::ComponentInfo& info = m_world.m_componentInfos[componentId];
+            if (count == info.m_sparseSet->size()) {
+                info.m_sparseSet->clear();
+                if (info.m_group >= 0) {
+                    m_world.m_groups[info.m_group].m_size = 0;
+                }
+                count = 0;
+            }
+        }
+        for (Entity entity : entities) {
+            World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+            if (!m_world.m_groups.empty()) {
+                m_world.forEachGroup(m_world.componentsOf(entityInfo), [this, entity](World::GroupInfo& group) {
+                    m_world.leaveGroup(group, entity);
+                });
+            }
+            for (ComponentID componentId : m_world.componentsOf(entityInfo)) {
+                if (m_bulkCounts[componentId] != 0) {
+                    m_world.m_componentInfos[componentId].m_sparseSet->remove(entity);
+                }
+            }
+            releaseEntityInfo(entity);
+        }
+    }
+
+    void releaseEntityInfo(Entity entity) {
+        World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+        entityInfo.m_signature = 0;
+        entityInfo.m_entity = null_entity;
+        m_world.releaseEntity(entity);
+    }
+
+    void destroyEntity(Entity entity) {
+        if (!m_world.isAlive(entity)) {
+            return;
+        }
+
+        World::EntityInfo& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            World::Archetype& archetype = m_world.m_archetypes[entityInfo.m_archetype];
+            Entity moved = archetype.swap_and_pop(entityInfo.m_row);
+            if (moved != null_entity) {
+                m_world.m_entities[internal::entity_id(moved)].m_row = entityInfo.m_row;
+            }
+        } else {
+            if (!m_world.m_groups.empty()) {
+                m_world.forEachGroup(m_world.componentsOf(entityInfo), [this, entity](World::GroupInfo& group) {
+                    m_world.leaveGroup(group, entity);
+                });
+            }
+            for (ComponentID componentId : m_world.componentsOf(entityInfo)) {
+                if (World::ComponentInfo* info = m_world.findComponent(componentId)) {
+                    info->m_sparseSet->remove(entity);
+                }
+            }
+        }
+        releaseEntityInfo(entity);
+    }
+
+    void destroyResource(ComponentID componentId) {
+        if (componentId < m_world.m_resources.size()) {
+            m_world.m_resources[componentId].Reset();
+        }
+    }
 
-    void Update();
+    //系统运行前设置, 之后记录的DestroyAll用它过滤Added/Changed
+    void setRunTicks(Tick lastRun, Tick thisRun) {
+        m_lastRunTick = lastRun;
+        m_thisRunTick = thisRun;
+    }
 
-    void Shutdown() {
-        m_entities.clear();
+private:
+    World& m_world;
+    Tick m_lastRunTick {0}; //记录命令的系统的tick窗口, 见Queryer
+    Tick m_thisRunTick {0};
 
-        m_componentMap.clear();
+    std::vector<Entity> m_destroyEntities; //待销毁的实体
+    std::vector<DestroyQueryInfo> m_destroyQueries; //DestroyAll
+    std::vector<Entity> m_bulkEntities; //执行DestroyAll时的临时数组
+    std::vector<size_t> m_bulkCounts;
+    std::vector<ComponentID> m_destoryResources; //待销毁的资源
+    std::vector<EntitySpawnInfo> m_spawnEntities; //待创建的实体
+    std::vector<SpawnBatchInfo> m_spawnBatches; //待批量创建的实体
+    std::vector<Entity> m_batchEntities; //执行批量创建时的临时数组
+    World::ComponentContainer m_spawnComponents; //执行Spawn时的临时数组
+    std::vector<ComponentChangeInfo> m_changeComponents; //待增删的组件, 按记录顺序执行
+    linear_arena m_arena; //每帧执行创建实体的命令后重置
+    std::vector<ResourceCreateInfo> m_createResources; //待创建的实体
+    std::vector<std::unique_ptr<EventQueueBase>> m_eventQueues; //待发送的事件
 
-        m_resources.clear();
+    std::vector<std::unique_ptr<Commands>> m_chunkCommands;
+};
 
-        m_startUpSystems.clear();
-        m_systems.clear();
-    }
+//! @brief 惰性查询结果, 遍历时直接读取稀疏集(或archetype表), 不分配内存
+//!        遍历过程中不能创建或删除实体
+//!        查询条件可以是组件类型T, Without<T>, Optional<T>, Added<T> 或 Changed<T>,
+//!        至少要有一个T, Added<T> 或 Changed<T>
+template<typename ...QueryTerms>
+class QueryView final {
+public:
+    friend class Commands;
 
-private:
-    std::vector<FStartUpSystem> m_startUpSystems;
-    std::vector<FSystem> m_systems;
+    static constexpr size_t TermCount = sizeof...(QueryTerms);
+    static constexpr size_t DefaultGrainSize = 1024;
+    static_assert((internal::is_required_term(internal::query_term<QueryTerms>::kind) || ...), 
+                  "query need at least one required component");
+
+    class Iterator final {
+    public:
+        using value_type = Entity;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Entity*;
+        using reference = Entity;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        Iterator(const QueryView* view, size_t chunk, size_t pos) 
+            : m_view(view), m_chunk(chunk), m_pos(pos) {
+            seek();
+        }
 
-private:
-    //Entity and Component
-    struct Pool final {
-        std::vector<void*> m_instance;
-        std::vector<void*> m_cache;
-
-        using CreateFunc = void*(*)(void);
-        using DestroyFunc = void(*)(void*);
-
-        CreateFunc m_create;
-        DestroyFunc m_destroy;
-
-        Pool() = delete;
-        Pool(const Pool&) = delete;
-        Pool& operator=(const Pool&) = delete;
-        Pool(Pool&&) = default;
-        Pool& operator=(Pool&&) = default;
-
-        Pool(CreateFunc create, DestroyFunc destroy) 
-            : m_create(create), m_destroy(destroy) { }
-        ~Pool() {
-            DestroyData();
-            m_create = nullptr;
-            m_destroy = nullptr;
-        }
-
-        void* Create() {
-            if (!m_cache.empty()) {
-                m_instance.push_back(m_cache.back());
-                m_cache.pop_back();
-            } else {
-                m_instance.push_back(m_create());
+        Entity operator*() const {
+            if (m_view->isArchetype()) {
+                return m_view->archetypes()[m_chunk].entities()[m_pos];
             }
-            return m_instance.back();
+            return m_view->m_driving->packed()[m_pos - 1];
         }
 
-        void Destroy(void *elem) {
-            auto it = std::find(m_instance.begin(), m_instance.end(), elem);
-            if (it != m_instance.end()) {
-                m_cache.push_back(*it);
-                std::swap(*it, m_instance.back());
-                m_instance.pop_back();
+        Iterator& operator++() {
+            if (m_view->isArchetype()) {
+                ++m_pos;
             } else {
-                assertm("your element not in pool", false);
+                --m_pos;
             }
+            seek();
+            return *this;
         }
 
-        void DestroyData() {
-            for (auto dat : m_instance) {
-                m_destroy(dat);
-            }
-            m_instance.clear();
+        Iterator operator++(int) {
+            Iterator copy = *this;
+            ++(*this);
+            return copy;
+        }
 
-            for (auto dat : m_cache) {
-                m_destroy(dat);
-            }
-            m_cache.clear();
+        bool operator==(const Iterator& o) const {
+            return m_chunk == o.m_chunk && m_pos == o.m_pos;
         }
-    };
 
-    struct ComponentInfo{
-        Pool m_pool;
-        basic_sparse_set<Entity, 32> m_sparseSet;
+        bool operator!=(const Iterator& o) const {
+            return !(*this == o);
+        }
 
-        ComponentInfo() = delete;
-        ComponentInfo(const ComponentInfo&) = delete;
-        ComponentInfo& operator=(const ComponentInfo&) = delete;
-        ComponentInfo(ComponentInfo&&) = default;
-        ComponentInfo& operator=(ComponentInfo&&) = default;
-        ~ComponentInfo() {
-            m_pool.~Pool();
-            m_sparseSet.clear();
-        };
+    private:
+        //跳到下一个满足条件的实体
+        void seek() {
+            if (m_view->isArchetype()) {
+                auto& archetypes = m_view->archetypes();
+                while (m_chunk < archetypes.size()) {
+                    auto& archetype = archetypes[m_chunk];
+                    if (m_view->match(archetype)) {
+                        while (m_pos < archetype.size() && !m_view->matchTicks(archetype, m_pos)) {
+                            ++m_pos;
+                        }
+                        if (m_pos < archetype.size()) {
+                            break;
+                        }
+                    }
+                    ++m_chunk;
+                    m_pos = 0;
+                }
+            } else {
+                while (m_pos > 0 && !m_view->match(m_view->m_driving->packed()[m_pos - 1])) {
+                    --m_pos;
+                }
+            }
+        }
 
-        ComponentInfo(Pool::CreateFunc create, Pool::DestroyFunc destroy) : m_pool(create, destroy) { }
+        const QueryView* m_view {nullptr};
+        size_t m_chunk {0}; //StorageMode::Archetype 当前表
+        size_t m_pos {0}; //StorageMode::SparseSet 时是packed的偏移(从后往前), 否则是行号
     };
 
-    using ComponentMap = std::unordered_map<ComponentID, ComponentInfo>;
-    ComponentMap m_componentMap;
-
-    std::unordered_map<Entity, ComponentContainer> m_entities;
-
-    //Resource
-    struct ResourceInfo {
-        void* resource{nullptr};
+    //! @param lastRun, thisRun  Added/Changed比较的tick, 以非const引用访问的组件记为在thisRun修改
+    QueryView(World& world, Tick lastRun, Tick thisRun) 
+        : m_world(world), m_lastRun(lastRun), m_thisRun(thisRun) {
+        if (isArchetype()) {
+            return;
+        }
+        ComponentID componentIds[] = {componentId<typename internal::query_term<QueryTerms>::component_type>()...};
+        for (size_t i = 0; i < TermCount; i++) {
+            if (World::ComponentInfo* info = m_world.findComponent(componentIds[i])) {
+                m_sets[i] = info->m_sparseSet.get();
+            } else if (internal::is_required_term(Kinds[i])) {
+                //必需的组件从未创建过, 结果为空
+                m_driving = nullptr;
+                return;
+            }
+        }
+        //从最小的必需集合开始遍历, 其余集合只做contain检查
+        //一样大时优先Added/Changed的集合, 遍历时先按位置读取tick, 不满足的实体直接跳过
+        for (size_t i = 0; i < TermCount; i++) {
+            if (internal::is_required_term(Kinds[i]) && 
+                (!m_driving || m_sets[i]->size() < m_driving->size() || 
+                 (m_sets[i]->size() == m_driving->size() && Kinds[i] != internal::query_term_kind::required))) {
+                m_driving = m_sets[i];
+            }
+        }
+        if constexpr (HasTickFilter) {
+            assureDrivingTicks(std::index_sequence_for<QueryTerms...>{});
+        }
+    }
 
-        using DestroyFunc = void(*)(void*);
+    //! @brief 所有组件都比较为新的
+    explicit QueryView(World& world) : QueryView(world, 0, world.m_tick.load(std::memory_order_relaxed)) {}
 
-        DestroyFunc m_destroy;
+    Iterator begin() const {
+        if (isArchetype()) {
+            return Iterator(this, 0, 0);
+        }
+        return Iterator(this, 0, m_driving ? m_driving->size() : 0);
+    }
 
-        ResourceInfo() = delete;
-        ResourceInfo(const ResourceInfo&) = delete;
-        ResourceInfo& operator=(const ResourceInfo&) = delete;
-        ResourceInfo(ResourceInfo&&) = default;
-        ResourceInfo& operator=(ResourceInfo&&) = default;
+    Iterator end() const {
+        if (isArchetype()) {
+            return Iterator(this, archetypes().size(), 0);
+        }
+        return Iterator(this, 0, 0);
+    }
 
-        ResourceInfo(DestroyFunc destroy) :m_destroy(destroy) {}
-        ~ResourceInfo() {
-            if (resource) {
-                m_destroy(resource);
-            }
-            resource = nullptr;
-            m_destroy = nullptr;
-        };
-    };
+    bool empty() const {
+        return begin() == end();
+    }
 
-    std::unordered_map<ComponentID, ResourceInfo> m_resources;
+    //! @brief 对每个满足条件的实体调用func, func的参数可以是
+    //!        (Entity, Components...), (Components...) 或 (Entity)
+    //!        Components按查询条件的顺序排列: T 传入 T&, Optional<T> 传入 T*(没有时为nullptr),
+    //!        Without<T> 不传入. 组件的存储在遍历前只查找一次
+    //!        非const的组件传给func时记为在thisRun修改, func只接受Entity时不修改tick
+    template<typename Func>
+    void each(Func&& func) const {
+        eachAll<TakesComponents<Func>>(func);
+    }
 
-private:
-    std::shared_ptr<Commands> createCommands();
-    void destoryCommands() {
-        m_commandsCache.insert(m_commandsCache.end(), m_commands.begin(), m_commands.end());
-        m_commands.clear();
+    //! @brief 同each, 把驱动集合的packed(或每张archetype表)按grainSize切块, 在World的线程池上并行遍历
+    //!        func会在多个线程上同时调用, 只能修改传给它的组件, 读取其他实体只能用Get<const T>和Has(同SystemAccess::Read)
+    //!        线程池不可用(World::SetThreadCount(1))时退化为each
+    template<typename Func>
+    void parEach(Func&& func, size_t grainSize = DefaultGrainSize) const {
+        thread_pool* pool = m_world.assureThreadPool();
+        if (!pool) {
+            each(func);
+            return;
+        }
+        std::vector<Chunk> chunks = makeChunks(grainSize);
+        runChunks(pool, chunks.size(), [this, &func, &chunks](size_t index) {
+            eachChunk<TakesComponents<Func>>(func, chunks[index]);
+        });
     }
-    std::vector<std::shared_ptr<Commands>> m_commands;
-    std::vector<std::shared_ptr<Commands>> m_commandsCache;
-};
 
-class Commands final {
-public:
-    friend class World;
+    //! @brief 同parEach, func的第一个参数是Commands&, 如 (Commands&, Entity, Components...)
+    //!        每块记录到自己的缓冲, 不需要加锁, 遍历结束后按块的顺序并入commands
+    template<typename Func>
+    void parEach(Commands& commands, Func&& func, size_t grainSize = DefaultGrainSize) const {
+        constexpr bool stamp = internal::takes_components<std::remove_reference_t<Func>, Args, true>::value;
+        thread_pool* pool = m_world.assureThreadPool();
+        if (!pool) {
+            auto wrapper = [&func, &commands](Entity entity, auto&... refs) {
+                internal::invoke_each_with_commands(func, commands, entity, refs...);
+            };
+            eachAll<stamp>(wrapper);
+            return;
+        }
+        std::vector<Chunk> chunks = makeChunks(grainSize);
+        commands.assureChunkCommands(chunks.size());
+        runChunks(pool, chunks.size(), [this, &func, &chunks, &commands](size_t index) {
+            Commands& chunkCommands = *commands.m_chunkCommands[index];
+            eachChunk<stamp>([&func, &chunkCommands](Entity entity, auto&... refs) {
+                internal::invoke_each_with_commands(func, chunkCommands, entity, refs...);
+            }, chunks[index]);
+        });
+        commands.mergeChunkCommands(chunks.size());
+    }
 
 private:
-    Commands(World& world) : m_world(world) {}
-public:
-    Commands(const Commands&) = default;
-    Commands& operator=(const Commands&) = default;
-    Commands(Commands&&) = default;
-    Commands& operator=(Commands&&) = default;
-    
-public:
-    template<typename ...ComponentTypes>
-    Entity SpawnAndReturn(ComponentTypes&& ...components) {
-        Entity entity = EntityGenerator::Gen();
-        EntitySpawnInfo spawnInfo(entity); 
-        doSpawn(spawnInfo, std::forward<ComponentTypes>(components)...);
-        m_spawnEntities.push_back(std::move(spawnInfo));
-        return entity;
+    static constexpr internal::query_term_kind Kinds[] = {internal::query_term<QueryTerms>::kind...};
+
+    template<size_t Index>
+    using TermAt = internal::query_term<std::tuple_element_t<Index, std::tuple<QueryTerms...>>>;
+
+    template<size_t Index>
+    using ComponentAt = typename TermAt<Index>::component_type;
+
+    template<size_t Index>
+    using PoolAt = World::Pool<std::remove_const_t<ComponentAt<Index>>>;
+
+    //以非const引用传给func的组件, 遍历时记为修改
+    template<size_t Index>
+    static constexpr bool Mutable = !std::is_const_v<ComponentAt<Index>> && 
+        (TermAt<Index>::kind == internal::query_term_kind::required || 
+         TermAt<Index>::kind == internal::query_term_kind::optional);
+
+    static constexpr bool HasTickFilter = 
+        ((internal::query_term<QueryTerms>::kind == internal::query_term_kind::added || 
+          internal::query_term<QueryTerms>::kind == internal::query_term_kind::changed) || ...);
+
+    //Added比较添加的tick, Changed比较修改的tick, 其它条件不检查(ticks可能为nullptr)
+    template<size_t Index>
+    bool tickMatch(const component_ticks* ticks, size_t index) const {
+        constexpr auto kind = TermAt<Index>::kind;
+        if constexpr (kind == internal::query_term_kind::added) {
+            return tick_newer(ticks[index].added, m_lastRun, m_thisRun);
+        } else if constexpr (kind == internal::query_term_kind::changed) {
+            return tick_newer(ticks[index].changed, m_lastRun, m_thisRun);
+        } else {
+            return true;
+        }
     }
 
-    template<typename ...ComponentTypes>
-    Commands& Spawn(ComponentTypes&& ...components) {
-        SpawnAndReturn(std::forward<ComponentTypes>(components)...);
-        return *this;
+    //驱动集合是Added/Changed的组件时记下它的tick
+    template<size_t ...Indices>
+    void assureDrivingTicks(std::index_sequence<Indices...>) {
+        ([&]() {
+            constexpr auto kind = TermAt<Indices>::kind;
+            if constexpr (kind == internal::query_term_kind::added || kind == internal::query_term_kind::changed) {
+                if (!m_drivingTicks && m_sets[Indices] == m_driving) {
+                    m_drivingTicks = &static_cast<PoolAt<Indices>*>(m_sets[Indices])->ticks();
+                    m_drivingAdded = kind == internal::query_term_kind::added;
+                }
+            }
+        }(), ...);
     }
 
-    Commands& Destroy(Entity entity) {
-        m_destroyEntities.push_back(entity);
-        return *this;
+    bool drivingTickMatch(const component_ticks& ticks) const {
+        return tick_newer(m_drivingAdded ? ticks.added : ticks.changed, m_lastRun, m_thisRun);
     }
 
-    template<typename ComponentType>
-    ComponentType& SetResource(ComponentType&& component) {
-        ComponentID componentId = IndexGetter<Resource>::Get<ComponentType>();
-        auto it = m_world.m_resources.find(componentId);
-        if (it == m_world.m_resources.end()) {
-            auto emret = m_world.m_resources.try_emplace(
-                    componentId, 
-                    World::ResourceInfo(
-                        [](void* data) {
-                            delete (ComponentType*)data;
-                        }
-                    ));
-            it = emret.first;
+    //驱动集合的组件和packed对齐, 直接按位置读取, 其余集合按实体查找
+    template<size_t Index, bool Stamp>
+    auto sparseSetArg(Entity entity, size_t drivingPos) const {
+        constexpr auto kind = TermAt<Index>::kind;
+        if constexpr (kind == internal::query_term_kind::required) {
+            auto* pool = static_cast<PoolAt<Index>*>(m_sets[Index]);
+            size_t index = m_sets[Index] == m_driving ? drivingPos : pool->index(entity);
+            if constexpr (Stamp && Mutable<Index>) {
+                pool->ticks()[index].changed = m_thisRun;
+            }
+            return std::tuple<ComponentAt<Index>&>(pool->payload()[index]);
+        } else if constexpr (kind == internal::query_term_kind::optional) {
+            auto* pool = static_cast<PoolAt<Index>*>(m_sets[Index]);
+            if (!pool || !pool->contain(entity)) {
+                return std::tuple<ComponentAt<Index>*>(nullptr);
+            }
+            size_t index = pool->index(entity);
+            if constexpr (Stamp && Mutable<Index>) {
+                pool->ticks()[index].changed = m_thisRun;
+            }
+            return std::tuple<ComponentAt<Index>*>(&pool->payload()[index]);
+        } else {
+            return std::tuple<>();
         }
-        World::ResourceInfo& resourceInfo = it->second;
-        assertm("resource already set", resourceInfo.resource == nullptr);
-
-        void* compData = new ComponentType(std::forward<ComponentType>(component));
-        ResourceCreateInfo info(componentId, compData);
-        m_createResources.push_back(std::move(info));
-        return *((ComponentType*)compData);
     }
 
-    template<typename ComponentType>
-    Commands& RemoveResource() {
-        ComponentID componentId = IndexGetter<Resource>::Get<ComponentType>();
-        m_destoryResources.push_back(componentId);
-        return *this;
+    //StorageMode::SparseSet 时archetype为nullptr, [first, last)是驱动集合packed的范围
+    struct Chunk {
+        const World::Archetype* archetype;
+        size_t first;
+        size_t last;
+    };
+
+    std::vector<Chunk> makeChunks(size_t grainSize) const {
+        grainSize = std::max<size_t>(grainSize, 1);
+        std::vector<Chunk> chunks;
+        if (isArchetype()) {
+            for (auto& archetype : archetypes()) {
+                if (!match(archetype)) {
+                    continue;
+                }
+                for (size_t first = 0; first < archetype.size(); first += grainSize) {
+                    chunks.push_back({&archetype, first, std::min(first + grainSize, archetype.size())});
+                }
+            }
+        } else if (m_driving) {
+            //和each一样从后往前, 按块的顺序拼起来就是each的遍历顺序
+            for (size_t last = m_driving->size(); last > 0; last -= std::min(last, grainSize)) {
+                chunks.push_back({nullptr, last - std::min(last, grainSize), last});
+            }
+        }
+        return chunks;
     }
 
-    void Execute() {
-        for (auto& entity : m_destroyEntities) {
-            destroyEntity(entity);
+    //Stamp: 把非const的组件记为在thisRun修改, 见TakesComponents
+    template<bool Stamp, typename Func>
+    void eachAll(Func& func) const {
+        if (isArchetype()) {
+            for (auto& archetype : archetypes()) {
+                if (match(archetype)) {
+                    eachArchetype<Stamp>(func, archetype, 0, archetype.size(), std::index_sequence_for<QueryTerms...>{});
+                }
+            }
+        } else if (m_driving) {
+            eachSparseSet<Stamp>(func, 0, m_driving->size(), std::index_sequence_for<QueryTerms...>{});
         }
-        m_destroyEntities.clear();
+    }
 
-        for (auto& componentId : m_destoryResources) {
-            destroyResource(componentId);
+    template<bool Stamp, typename Func>
+    void eachChunk(Func&& func, const Chunk& chunk) const {
+        if (chunk.archetype) {
+            eachArchetype<Stamp>(func, *chunk.archetype, chunk.first, chunk.last, std::index_sequence_for<QueryTerms...>{});
+        } else {
+            eachSparseSet<Stamp>(func, chunk.first, chunk.last, std::index_sequence_for<QueryTerms...>{});
         }
-        m_destoryResources.clear();
+    }
 
-        for (auto& entitySpawnInfo : m_spawnEntities) {
-            doSpawnWithoutType(entitySpawnInfo);
+    //对[0, count)中的每个下标在线程池上调用job, 当前线程也参与, 在系统内部调用时不会阻塞工作线程
+    template<typename Job>
+    static void runChunks(thread_pool* pool, size_t count, Job&& job) {
+        std::atomic<size_t> pending {count};
+        for (size_t i = 0; i < count; i++) {
+            pool->submit([&pending, &job, i]() {
+                job(i);
+                pending.fetch_sub(1);
+            });
         }
-        m_spawnEntities.clear();
+        pool->wait([&pending]() { return pending.load() == 0; });
+    }
 
-        for (auto& resourceCreateInfo : m_createResources) {
-            createResourceWithoutType(resourceCreateInfo);
+    //遍历packed的[first, last), 从后往前
+    template<bool Stamp, typename Func, size_t ...Indices>
+    void eachSparseSet(Func& func, size_t first, size_t last, std::index_sequence<Indices...>) const {
+        auto& packed = m_driving->packed();
+        for (size_t pos = last; pos > first; pos--) {
+            if constexpr (HasTickFilter) {
+                if (m_drivingTicks && !drivingTickMatch((*m_drivingTicks)[pos - 1])) {
+                    continue;
+                }
+            }
+            Entity entity = packed[pos - 1];
+            if (match(entity)) {
+                auto args = std::tuple_cat(sparseSetArg<Indices, Stamp>(entity, pos - 1)...);
+                std::apply([&func, entity](auto&... refs) {
+                    internal::invoke_each(func, entity, refs...);
+                }, args);
+            }
         }
-        m_createResources.clear();
     }
 
-private:
-    struct ComponentSpawnInfo {
-        ComponentID m_componentId {0}; 
-        void* m_componentData {nullptr};
-        ComponentSpawnInfo(ComponentID componentId, void* rawData)
-            : m_componentId(componentId), m_componentData(rawData) {}
-
-        ComponentSpawnInfo() = delete;
-        ComponentSpawnInfo(const ComponentSpawnInfo&) = delete;
-        ComponentSpawnInfo& operator=(const ComponentSpawnInfo&) = delete;
-        ComponentSpawnInfo(ComponentSpawnInfo&&) = default;
-        ComponentSpawnInfo& operator=(ComponentSpawnInfo&&) = default;
-        ~ComponentSpawnInfo() { 
-            m_componentId = 0; 
-            m_componentData = nullptr;
+    template<size_t Index>
+    ComponentAt<Index>* columnData(const World::Archetype& archetype) const {
+        constexpr auto kind = TermAt<Index>::kind;
+        if constexpr (kind != internal::query_term_kind::required && kind != internal::query_term_kind::optional) {
+            return nullptr;
+        } else {
+            internal::column* column = archetype.column(componentId<ComponentAt<Index>>());
+            if (!column) {
+                return nullptr;
+            }
+            return static_cast<internal::typed_column<std::remove_const_t<ComponentAt<Index>>>*>(column)->data.data();
         }
-    };
-    struct EntitySpawnInfo {
-        Entity m_entity;
-        std::vector<ComponentSpawnInfo> m_components;
+    }
 
-        EntitySpawnInfo(Entity entity) : m_entity(entity) {}
+    template<size_t Index>
+    static auto archetypeArg(ComponentAt<Index>* data, size_t row) {
+        constexpr auto kind = TermAt<Index>::kind;
+        if constexpr (kind == internal::query_term_kind::required) {
+            return std::tuple<ComponentAt<Index>&>(data[row]);
+        } else if constexpr (kind == internal::query_term_kind::optional) {
+            return std::tuple<ComponentAt<Index>*>(data ? data + row : nullptr);
+        } else {
+            return std::tuple<>();
+        }
+    }
 
-        EntitySpawnInfo() = delete;
-        EntitySpawnInfo(const EntitySpawnInfo&) = delete;
-        EntitySpawnInfo& operator=(const EntitySpawnInfo&) = delete;
-        EntitySpawnInfo(EntitySpawnInfo&&) = default;
-        EntitySpawnInfo& operator=(EntitySpawnInfo&&) = default;
-    };
+    //传给func的组件参数, 见each
+    template<size_t ...Indices>
+    static auto argsOf(std::index_sequence<Indices...>) 
+        -> decltype(std::tuple_cat(archetypeArg<Indices>(nullptr, 0)...));
+    using Args = decltype(argsOf(std::index_sequence_for<QueryTerms...>{}));
+
+    //func拿到组件时才把非const的组件记为修改, Query/size等只看实体的遍历不写tick
+    template<typename Func>
+    static constexpr bool TakesComponents = internal::takes_components<std::remove_reference_t<Func>, Args>::value;
+
+    //Added/Changed以及会被修改的组件需要tick, 其它为nullptr
+    template<size_t Index>
+    component_ticks* columnTicks(const World::Archetype& archetype) const {
+        constexpr auto kind = TermAt<Index>::kind;
+        if constexpr (Mutable<Index> || kind == internal::query_term_kind::added || 
+                      kind == internal::query_term_kind::changed) {
+            internal::column* column = archetype.column(componentId<ComponentAt<Index>>());
+            return column ? column->ticks.data() : nullptr;
+        } else {
+            return nullptr;
+        }
+    }
 
-    template<typename ComponentType, typename ...Remains>
-    void doSpawn(EntitySpawnInfo &spawnInfo, ComponentType&& component, Remains&&... remains) {
-        ComponentID componentId = IndexGetter<Component>::Get<ComponentType>();
-        auto it = m_world.m_componentMap.find(componentId);
-        if (it == m_world.m_componentMap.end()) {
-            auto emret = m_world.m_componentMap.try_emplace(
-                componentId, 
-                World::ComponentInfo(
-                    []() -> void* {
-                        return new ComponentType;
-                    }, 
-                    [](void* elemData) {
-                        delete (ComponentType*)elemData;
+    //遍历一张表的[first, last)行
+    template<bool Stamp, typename Func, size_t ...Indices>
+    void eachArchetype(Func& func, const World::Archetype& archetype, size_t first, size_t last, 
+                       std::index_sequence<Indices...>) const {
+        std::tuple<ComponentAt<Indices>*...> columns(columnData<Indices>(archetype)...);
+        std::array<component_ticks*, TermCount> ticks {columnTicks<Indices>(archetype)...};
+        auto& entities = archetype.entities();
+        for (size_t row = first; row < last; row++) {
+            if constexpr (HasTickFilter) {
+                if (!(tickMatch<Indices>(ticks[Indices], row) && ...)) {
+                    continue;
+                }
+            }
+            ([&]() {
+                if constexpr (Stamp && Mutable<Indices>) {
+                    if (ticks[Indices]) {
+                        ticks[Indices][row].changed = m_thisRun;
                     }
-                ));
-            it = emret.first;
+                }
+            }(), ...);
+            auto args = std::tuple_cat(archetypeArg<Indices>(std::get<Indices>(columns), row)...);
+            std::apply([&func, &entities, row](auto&... refs) {
+                internal::invoke_each(func, entities[row], refs...);
+            }, args);
         }
+    }
+
+    template<typename ComponentType>
+    static ComponentID componentId() {
+        return TypeRegistry<Component>::Get<std::remove_const_t<ComponentType>>();
+    }
 
-        World::ComponentInfo& componentInfo = it->second;
-        void* elemRawData = componentInfo.m_pool.Create();
-        *((ComponentType*)elemRawData) = std::forward<ComponentType>(component);
+    bool isArchetype() const {
+        return m_world.m_storageMode == StorageMode::Archetype;
+    }
 
-        spawnInfo.m_components.emplace_back(componentId, elemRawData);
+    const std::vector<World::Archetype>& archetypes() const {
+        return m_world.m_archetypes;
+    }
 
-        if constexpr(sizeof...(remains) != 0) {
-            doSpawn<Remains...>(spawnInfo, std::forward<Remains>(remains)...);
+    bool match(Entity entity) const {
+        for (size_t i = 0; i < TermCount; i++) {
+            World::SparseSet* set = m_sets[i];
+            switch (Kinds[i]) {
+            case internal::query_term_kind::required:
+            case internal::query_term_kind::added:
+            case internal::query_term_kind::changed:
+                if (set != m_driving && !set->contain(entity)) {
+                    return false;
+                }
+                break;
+            case internal::query_term_kind::exclude:
+                if (set && set->contain(entity)) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+            }
         }
+        if constexpr (HasTickFilter) {
+            return matchTicks(entity, std::index_sequence_for<QueryTerms...>{});
+        }
+        return true;
     }
 
-    void doSpawnWithoutType(EntitySpawnInfo &spawnInfo) {
-        Entity entity = spawnInfo.m_entity;
-        for (auto& componentSpawnInfo : spawnInfo.m_components) {
-            ComponentID componentId = componentSpawnInfo.m_componentId;
-            auto it = m_world.m_componentMap.find(componentId);
-            if (it == m_world.m_componentMap.end()) {
-                assertm("componentInfo not create", false);
+    template<size_t ...Indices>
+    bool matchTicks(Entity entity, std::index_sequence<Indices...>) const {
+        return ([&]() {
+            if constexpr (TermAt<Indices>::kind == internal::query_term_kind::added || 
+                          TermAt<Indices>::kind == internal::query_term_kind::changed) {
+                auto* pool = static_cast<PoolAt<Indices>*>(m_sets[Indices]);
+                return tickMatch<Indices>(pool->ticks().data(), pool->index(entity));
+            } else {
+                return true;
             }
-            World::ComponentInfo& componentInfo = it->second;
+        }() && ...);
+    }
 
-            componentInfo.m_sparseSet.insert(entity);
+    bool match(const World::Archetype& archetype) const {
+        return (matchTerm<QueryTerms>(archetype) && ...);
+    }
 
-            m_world.m_entities[entity][componentId] = componentSpawnInfo.m_componentData;
+    //表中的一行是否满足Added/Changed, 只在Iterator中使用, each直接读取列的tick
+    bool matchTicks(const World::Archetype& archetype, size_t row) const {
+        if constexpr (HasTickFilter) {
+            return matchTicks(archetype, row, std::index_sequence_for<QueryTerms...>{});
         }
+        return true;
     }
 
-    struct ResourceCreateInfo{
-        ComponentID m_componentId {0};
-        void* m_componentData {nullptr};
+    template<size_t ...Indices>
+    bool matchTicks(const World::Archetype& archetype, size_t row, std::index_sequence<Indices...>) const {
+        return (tickMatch<Indices>(columnTicks<Indices>(archetype), row) && ...);
+    }
 
-        ResourceCreateInfo(ComponentID componentId, void* componentData)
-            : m_componentId(componentId), m_componentData(componentData) {}
-        ResourceCreateInfo() = delete;
-        ResourceCreateInfo(const ResourceCreateInfo&) = delete;
-        ResourceCreateInfo& operator=(const ResourceCreateInfo&) = delete;
-        ResourceCreateInfo(ResourceCreateInfo&&) = default;
-        ResourceCreateInfo& operator=(ResourceCreateInfo&&) = default;
-        ~ResourceCreateInfo() {
-            m_componentId = 0;
-            m_componentData = nullptr;
+    template<typename QueryTerm>
+    static bool matchTerm(const World::Archetype& archetype) {
+        using term = internal::query_term<QueryTerm>;
+        ComponentID id = componentId<typename term::component_type>();
+        if constexpr (internal::is_required_term(term::kind)) {
+            return archetype.has(id);
+        } else if constexpr (term::kind == internal::query_term_kind::exclude) {
+            return !archetype.has(id);
+        } else {
+            return true;
         }
-    };
+    }
 
-    void createResourceWithoutType(ResourceCreateInfo& info) {
-        ComponentID componentId = info.m_componentId;
-        auto it = m_world.m_resources.find(componentId);
-        if (it == m_world.m_resources.end()) {
-            assertm("resourceinfo not create", false);
+    World& m_world;
+    Tick m_lastRun;
+    Tick m_thisRun;
+    std::array<World::SparseSet*, TermCount> m_sets {}; //Without/Optional的组件从未创建过时为nullptr
+    World::SparseSet* m_driving {nullptr};
+    const std::vector<component_ticks>* m_drivingTicks {nullptr}; //StorageMode::SparseSet 驱动集合的tick
+    bool m_drivingAdded {false};
+};
+
+//! @brief 遍历 World::AddGroup 注册的group, StorageMode::Archetype 下等同于QueryView
+template<typename ...ComponentTypes>
+class GroupView final {
+public:
+    static constexpr size_t ComponentCount = sizeof...(ComponentTypes);
+
+    explicit GroupView(World& world) : GroupView(world, world.m_tick.load(std::memory_order_relaxed)) {}
+
+    //! @param thisRun  以非const引用访问的组件记为在thisRun修改
+    GroupView(World& world, Tick thisRun) : m_world(world), m_thisRun(thisRun) {
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            return;
         }
-        World::ResourceInfo& resourceInfo = it->second;
-        assertm("resource already set", resourceInfo.resource == nullptr);
-        resourceInfo.resource = info.m_componentData;
+        ComponentID componentIds[] = {TypeRegistry<Component>::Get<std::remove_const_t<ComponentTypes>>()...};
+        int32_t groupIdx = -1;
+        for (size_t i = 0; i < ComponentCount; i++) {
+            World::ComponentInfo* found = m_world.findComponent(componentIds[i]);
+            assertm("group not registe", found != nullptr);
+            World::ComponentInfo& info = *found;
+            assertm("group not registe", info.m_group >= 0 && (groupIdx < 0 || groupIdx == info.m_group));
+            groupIdx = info.m_group;
+            m_sets[i] = info.m_sparseSet.get();
+        }
+        m_group = &m_world.m_groups[groupIdx];
+        assertm("group not registe", m_group->m_sets.size() == ComponentCount);
     }
 
-    void destroyEntity(Entity entity) {
-        auto it = m_world.m_entities.find(entity);
-        if (it != m_world.m_entities.end()) {
-            for (auto [componentId, elemData]: it->second) {
-                auto it = m_world.m_componentMap.find(componentId);
-                if (it != m_world.m_componentMap.end()) {
-                    auto& componentInfo = it->second;
-                    componentInfo.m_pool.Destroy(elemData);
-                    componentInfo.m_sparseSet.remove(entity);
-                }
-            }
-            m_world.m_entities.erase(it);
+    size_t size() const {
+        if (!m_group) {
+            size_t count = 0;
+            QueryView<ComponentTypes...>(m_world).each([&count](Entity) { count++; });
+            return count;
         }
+        return m_group->m_size;
     }
 
-    void destroyResource(ComponentID componentId) {
-        auto it = m_world.m_resources.find(componentId);
-        if (it != m_world.m_resources.end()) {
-            World::ResourceInfo& resourceInfo = it->second;
-            if (resourceInfo.resource) {
-                resourceInfo.m_destroy(resourceInfo.resource);
-                resourceInfo.resource = nullptr;
-            }
+    bool empty() const {
+        return size() == 0;
+    }
+
+    //! @brief 同 QueryView::each, 按组内顺序线性遍历
+    template<typename Func>
+    void each(Func&& func) const {
+        if (!m_group) {
+            QueryView<ComponentTypes...>(m_world, 0, m_thisRun).each(std::forward<Func>(func));
+            return;
         }
+        eachGroup(func, std::index_sequence_for<ComponentTypes...>{});
     }
 
 private:
-    World& m_world;
+    template<typename Func, size_t ...Indices>
+    void eachGroup(Func& func, std::index_sequence<Indices...>) const {
+        std::tuple<ComponentTypes*...> payloads(
+            static_cast<World::Pool<std::remove_const_t<ComponentTypes>>*>(m_sets[Indices])->payload().data()...);
+        //const的组件, 以及func只接受Entity时不记录修改, 为nullptr
+        constexpr bool stamp = internal::takes_components<std::remove_reference_t<Func>, std::tuple<ComponentTypes&...>>::value;
+        std::array<component_ticks*, ComponentCount> ticks {(std::is_const_v<ComponentTypes> || !stamp ? nullptr :
+            static_cast<World::Pool<std::remove_const_t<ComponentTypes>>*>(m_sets[Indices])->ticks().data())...};
+        const auto* entities = m_sets[0]->packed().data();
+        //和QueryView一样从后往前, World::Sort之后两者的顺序相同
+        for (size_t i = m_group->m_size; i-- > 0;) {
+            for (component_ticks* componentTicks : ticks) {
+                if (componentTicks) {
+                    componentTicks[i].changed = m_thisRun;
+                }
+            }
+            internal::invoke_each(func, entities[i], std::get<Indices>(payloads)[i]...);
+        }
+    }
 
-    std::vector<Entity> m_destroyEntities; //待销毁的实体
-    std::vector<ComponentID> m_destoryResources; //待销毁的资源
-    std::vector<EntitySpawnInfo> m_spawnEntities; //待创建的实体
-    std::vector<ResourceCreateInfo> m_createResources; //待创建的实体
+    World& m_world;
+    Tick m_thisRun;
+    World::GroupInfo* m_group {nullptr};
+    std::array<World::SparseSet*, ComponentCount> m_sets {};
 };
 
 class Queryer final {
 public:
-    Queryer(World& world) : m_world(world) {}
+    friend struct World;
 
-    template<typename ...ComponentTypes>
+    //! @brief 在系统外使用, Added/Changed把所有组件都当作新的
+    Queryer(World& world) : Queryer(world, 0, world.m_tick.load(std::memory_order_relaxed), nullptr) {}
+
+    //! @brief 返回满足条件的实体的拷贝, 遍历过程中需要增删实体时使用
+    //!        条件同 QueryView, 如 Query<A, Without<B>>()
+    template<typename ...QueryTerms>
     std::vector<Entity> Query() const {
-        return doQuery<ComponentTypes...>();
+        std::vector<Entity> entities;
+        View<QueryTerms...>().each([&entities](Entity entity) {
+            entities.push_back(entity);
+        });
+        return entities;
+    }
+
+    //! @brief 不分配内存的惰性查询
+    template<typename ...QueryTerms>
+    QueryView<QueryTerms...> View() const {
+        return QueryView<QueryTerms...>(m_world, m_lastRunTick, m_thisRunTick);
+    }
+
+    //! @brief 遍历 World::AddGroup 注册过的group
+    template<typename ...ComponentTypes>
+    GroupView<ComponentTypes...> Group() const {
+        return GroupView<ComponentTypes...>(m_world, m_thisRunTick);
+    }
+
+    //! @brief 遍历满足条件的实体, 组件引用直接传给func, 见QueryView::each
+    //!        Each<const A, B> 以const引用传入A
+    template<typename ...QueryTerms, typename Func>
+    void Each(Func&& func) const {
+        View<QueryTerms...>().each(std::forward<Func>(func));
+    }
+
+    //! @brief 同Each, 分块后在World的线程池上并行遍历, 见QueryView::parEach
+    //!        grainSize是每块的实体数, 太小时调度开销大, 太大时负载不均
+    template<typename ...QueryTerms, typename Func>
+    void ParEach(Func&& func, size_t grainSize = QueryView<QueryTerms...>::DefaultGrainSize) const {
+        View<QueryTerms...>().parEach(std::forward<Func>(func), grainSize);
+    }
+
+    //! @brief 同ParEach, 回调可以通过第一个参数Commands&记录命令, 见QueryView::parEach
+    //!        commands传入系统的Commands, 记录的命令按块的顺序并入其中
+    template<typename ...QueryTerms, typename Func>
+    void ParEach(Commands& commands, Func&& func, size_t grainSize = QueryView<QueryTerms...>::DefaultGrainSize) const {
+        View<QueryTerms...>().parEach(commands, std::forward<Func>(func), grainSize);
     }
 
     //是否存在实体
     bool Exist(Entity entity) const { 
-        return m_world.m_entities.find(entity) == m_world.m_entities.end();
+        return m_world.isAlive(entity);
     }
 
     template<typename ComponentType>
     bool Has(Entity entity) const { 
-        auto eit = m_world.m_entities.find(entity);
-        if (eit == m_world.m_entities.end()) {
-            return false;
-        }
-        auto& componentContainer = eit->second;
-        ComponentID componentId = IndexGetter<Component>::Get<ComponentType>();
-        auto cit = componentContainer.find(componentId);
-        if (cit == componentContainer.end()) {
-            return false;
+        using Type = std::remove_const_t<ComponentType>;
+        ComponentID componentId = TypeRegistry<Component>::Get<Type>();
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            if (!m_world.isAlive(entity)) {
+                return false;
+            }
+            auto& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+            return m_world.m_archetypes[entityInfo.m_archetype].has(componentId);
         }
-        return true;
+        World::ComponentInfo* info = m_world.findComponent(componentId);
+        return info && info->m_sparseSet->contain(entity);
     }
 
-    //获取实体组件
+    //获取实体组件, Get<T>记为修改, Get<const T>不会
     template<typename ComponentType>
     ComponentType& Get(Entity entity) const { 
-        auto eit = m_world.m_entities.find(entity);
-        if (eit == m_world.m_entities.end()) {
-            assertm("entity not found", false);
+        using Type = std::remove_const_t<ComponentType>;
+        constexpr bool isMutable = !std::is_const_v<ComponentType>;
+        ComponentID componentId = TypeRegistry<Component>::Get<Type>();
+        if (m_world.m_storageMode == StorageMode::Archetype) {
+            assertm("entity not found", m_world.isAlive(entity));
+            auto& entityInfo = m_world.m_entities[internal::entity_id(entity)];
+            internal::column* column = m_world.m_archetypes[entityInfo.m_archetype].column(componentId);
+            assertm("component not create", column != nullptr);
+            if constexpr (isMutable) {
+                column->ticks[entityInfo.m_row].changed = m_thisRunTick;
+            }
+            return static_cast<internal::typed_column<Type>*>(column)->data[entityInfo.m_row];
         }
-        auto& componentContainer = eit->second;
-        ComponentID componentId = IndexGetter<Component>::Get<ComponentType>();
-        auto cit = componentContainer.find(componentId);
-        if (cit == componentContainer.end()) {
-            assertm("component not create", false);
+        World::ComponentInfo* info = m_world.findComponent(componentId);
+        assertm("component not create", info != nullptr);
+        World::ComponentInfo& componentInfo = *info;
+        assertm("entity not found", componentInfo.m_sparseSet->contain(entity));
+        auto& pool = componentInfo.pool<Type>();
+        if constexpr (isMutable) {
+            pool.ticks(entity).changed = m_thisRunTick;
         }
-        return *((ComponentType*)cit->second);
+        return pool.get(entity);
     }
 
-    template<typename ComponentType>
-    bool HasResource() const { 
-        ComponentID componentId = IndexGetter<Resource>::Get<ComponentType>();
-        auto rit = m_world.m_resources.find(componentId);
-        if (rit == m_world.m_resources.end()) {
-            return false;
+    //! @brief 读取这个系统还没有读过的EventType事件, 读完后游标移到末尾, 同一帧再次调用返回空
+    //!        系统至少每两帧运行一次才不会漏掉事件; 在系统外使用时返回保留的所有事件, 不移动游标
+    //!        只能在运行系统的线程上调用
+    template<typename EventType>
+    EventReader<EventType> ReadEvents() const {
+        const Events<EventType>* events = m_world.findEvents<EventType>();
+        if (!events) {
+            return EventReader<EventType>();
         }
-        World::ResourceInfo& resourceInfo = rit->second;
-        if (!resourceInfo.resource) {
-            return false;
+        uint64_t cursor = events->OlderStart();
+        if (m_eventCursors) {
+            ComponentID eventId = TypeRegistry<Event>::Get<EventType>();
+            if (eventId >= m_eventCursors->size()) {
+                m_eventCursors->resize(eventId + 1, 0);
+            }
+            cursor = std::max(cursor, (*m_eventCursors)[eventId]);
+            (*m_eventCursors)[eventId] = events->End();
         }
-        return resourceInfo.resource != nullptr;
+        auto& older = events->Older();
+        auto& newer = events->Newer();
+        size_t olderSkip = static_cast<size_t>(std::min<uint64_t>(cursor - events->OlderStart(), older.size()));
+        size_t newerSkip = static_cast<size_t>(cursor - events->OlderStart() - olderSkip);
+        return EventReader<EventType>(older.data() + olderSkip, older.size() - olderSkip,
+                                      newer.data() + newerSkip, newer.size() - newerSkip);
+    }
+
+    template<typename ComponentType>
+    bool HasResource() const { 
+        return m_world.findResource(TypeRegistry<Resource>::Get<ComponentType>()) != nullptr;
     }
 
     //获取资源
     template<typename ComponentType>
     ComponentType& GetResource() const { 
-        ComponentID componentId = IndexGetter<Resource>::Get<ComponentType>();
-        auto rit = m_world.m_resources.find(componentId);
-        if (rit == m_world.m_resources.end()) {
-            assertm("component not create", false);
-        }
-        World::ResourceInfo& resourceInfo = rit->second;
-        if (!resourceInfo.resource) {
-            assertm("component not create", false);
-        }
-        return *(ComponentType*)resourceInfo.resource;
+        void* resource = m_world.findResource(TypeRegistry<Resource>::Get<ComponentType>());
+        assertm("component not create", resource != nullptr);
+        return *(ComponentType*)resource;
     }
 
 private:
-    template<typename ComponentType, typename ...Remains>
-    std::vector<Entity> doQuery() const {
-        std::vector<Entity> entities;
-        ComponentID componentId = IndexGetter<Component>::Get<ComponentType>();
-        auto cit = m_world.m_componentMap.find(componentId);
-        if (cit == m_world.m_componentMap.end()) {
-            return entities;
-        }
-
-        World::ComponentInfo& componentInfo = cit->second;
-        auto eit = componentInfo.m_sparseSet.cbegin();
-        for (; eit != componentInfo.m_sparseSet.end(); eit++) {
-            Entity entity = *eit;
-            if constexpr(sizeof...(Remains) == 0) {
-                entities.push_back(entity);
-            } else {
-                if (doQueryR<Remains...>(entity)) {
-                    entities.push_back(entity);
-                }
-            }
-        }
-        return entities;
-    }
-
-    template<typename ComponentType, typename ...Remains>
-    bool doQueryR(Entity entity) const {
-        ComponentID componentId = IndexGetter<Component>::Get<ComponentType>();
-        auto cit = m_world.m_componentMap.find(componentId);
-        if (cit == m_world.m_componentMap.end()) {
-            return false;
-        }
+    Queryer(World& world, Tick lastRunTick, Tick thisRunTick, std::vector<uint64_t>* eventCursors) 
+        : m_world(world), m_lastRunTick(lastRunTick), m_thisRunTick(thisRunTick), m_eventCursors(eventCursors) {}
 
-        World::ComponentInfo& componentInfo = cit->second;
-        if (!componentInfo.m_sparseSet.contain(entity)) {
-            return false;
-        }
-
-        if constexpr(sizeof...(Remains) != 0) {
-            return doQueryR<Remains...>(entity);
-        } else {
-            return true;
-        }
-    }
-
-private:
     World& m_world;
+    Tick m_lastRunTick; //系统上次运行的tick, 见Added/Changed
+    Tick m_thisRunTick;
+    std::vector<uint64_t>* m_eventCursors; //系统的事件游标, 在系统外使用时为nullptr
 };
 
 } // namespace cppecs
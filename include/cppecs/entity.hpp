@@ -141,12 +141,12 @@ public:
 
 template <typename EntityT>
 constexpr bool operator==(EntityT entity, null_entity_t null) {
-    return null == entity;
+    return null.operator==(entity);
 }
 
 template <typename EntityT>
 constexpr bool operator!=(EntityT entity, null_entity_t null) {
-    return null != entity;
+    return null.operator!=(entity);
 }
 
 }  // namespace internal
@@ -3,7 +3,9 @@
 #include "cppecs/entity.hpp"
 #include "cppecs/utility.hpp"
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
 #include <limits>
 #include <memory>
@@ -12,6 +14,11 @@
 #include <utility>
 #include <vector>
 #include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace cppecs {
 
@@ -108,8 +115,12 @@ private:
 
 /**
  * @brief sparse set for storing entity
+ *        the sparse array is split into pages which are only allocated when
+ *        an entity in them is inserted, the others point to one shared
+ *        read-only null page, so a component that few entities have only
+ *        pays for the pages it touches
  * @tparam EntityT  the entity type
- * @tparam PageSize  the page size
+ * @tparam PageSize  the default page size, can be changed per set at runtime
  **/
 template <typename EntityT, size_t PageSize>
 class basic_sparse_set {
@@ -119,15 +130,40 @@ public:
         typename internal::entity_traits<EntityT>::entity_type;
     using entity_type = EntityT;
     using packed_container_type = std::vector<entity_numeric_type>;
-    using page_type = std::array<size_t, PageSize>;
-    using sparse_container_type = std::vector<page_type>;
+    //! @brief an entry only needs to hold a position in packed, which is
+    //!        never larger than the entity id
+    using sparse_entry_type =
+        typename internal::entity_traits<EntityT>::entity_mask_type;
+    using sparse_container_type = std::vector<sparse_entry_type*>;
     using size_type = typename packed_container_type::size_type;
-    static constexpr typename page_type::value_type null_sparse_data =
-        std::numeric_limits<typename page_type::value_type>::max();
+    static constexpr sparse_entry_type null_sparse_data =
+        std::numeric_limits<sparse_entry_type>::max();
+    static constexpr size_t max_page_size = 4096;
     using iterator =
         internal::sparse_set_iterator<basic_sparse_set<EntityT, PageSize>>;
     using const_iterator = iterator;
 
+    static_assert(is_power_of_2(PageSize) && PageSize <= max_page_size,
+                  "page size must be a power of 2 and at most max_page_size");
+
+    explicit basic_sparse_set(size_t page_size = PageSize) noexcept {
+        init_page_size(page_size);
+    }
+
+    basic_sparse_set(const basic_sparse_set&) = delete;
+    basic_sparse_set& operator=(const basic_sparse_set&) = delete;
+    basic_sparse_set(basic_sparse_set&&) = default;
+    basic_sparse_set& operator=(basic_sparse_set&& o) noexcept {
+        if (this != &o) {
+            release_pages();
+            packed_ = std::move(o.packed_);
+            sparse_ = std::move(o.sparse_);
+            page_shift_ = o.page_shift_;
+            page_mask_ = o.page_mask_;
+        }
+        return *this;
+    }
+
     //! @brief insert an entity
     entity_type insert(entity_type entity) noexcept {
         using traits = internal::entity_traits<entity_type>;
@@ -135,25 +171,20 @@ public:
 
         auto id = internal::entity_id(entity);
         packed_.push_back(internal::entity_to_integral(entity));
-        assure(page(id))[offset(id)] = packed_.size() - 1u;
+        assure(page(id))[offset(id)] =
+            static_cast<sparse_entry_type>(packed_.size() - 1u);
         return internal::construct_entity<entity_type>(
             0, static_cast<typename traits::entity_mask_type>(packed_.size() -
                                                               1u));
     }
 
     //! @brief remove an entity
-    virtual void remove(entity_type entity) noexcept {
+    void remove(entity_type entity) noexcept {
         if (!contain(entity)) {
             return;
         }
 
-        auto id = internal::entity_id(entity);
-        auto& ref = sparse_ref(id);
-        auto pos = ref;
-        packed_[pos] = std::move(packed_.back());
-        sparse_ref(internal::entity_id(packed_[pos])) = pos;
-        ref = null_sparse_data;
-        packed_.pop_back();
+        swap_and_pop(entity, index(entity));
     }
 
     //! @brief pump a entity to the idx and return it
@@ -163,11 +194,71 @@ public:
         auto id = internal::entity_id(src);
         auto& ref1 = sparse_ref(id);
         auto& ref2 = sparse_ref(internal::entity_id(dst));
+        if (ref1 != ref2) {
+            swap_at(ref1, ref2);
+        }
         std::swap(packed_[ref2], packed_[ref1]);
         std::swap(ref1, ref2);
         return packed_[ref1];
     }
 
+    //! @brief sort the entities so that iterating the set visits them in
+    //!        the order of compare, derived classes keep their data in the
+    //!        same order through swap_at
+    //! @param compare  strict weak ordering of two entities, it is called
+    //!        before anything moves
+    template <typename Compare>
+    void sort(Compare compare) {
+        sort(0, packed_.size(), std::move(compare));
+    }
+
+    //! @brief same as sort(compare) but only the entities at [first, last)
+    //!        of packed are reordered, the others don't move
+    template <typename Compare>
+    void sort(size_t first, size_t last, Compare compare) {
+        GECS_ASSERT(first <= last && last <= packed_.size(),
+                    "sort range out of packed");
+        // iteration goes from the back of packed, so sort it backward
+        packed_container_type order(packed_.begin() + first,
+                                    packed_.begin() + last);
+        std::sort(order.rbegin(), order.rend(), std::move(compare));
+        for (size_t pos = first; pos < last; pos++) {
+            auto entity = order[pos - first];
+            if (packed_[pos] != entity) {
+                pump(entity, packed_[pos]);
+            }
+        }
+    }
+
+    //! @brief reorder the entities which are also in other to be visited
+    //!        first and in the same order as iterating other, the rest are
+    //!        visited after them in no particular order
+    void respect(const basic_sparse_set& other) {
+        respect(other, 0, packed_.size());
+    }
+
+    //! @brief same as respect(other) but only the entities at [first, last)
+    //!        of packed are reordered, the others don't move
+    void respect(const basic_sparse_set& other, size_t first, size_t last) {
+        GECS_ASSERT(first <= last && last <= packed_.size(),
+                    "respect range out of packed");
+        size_t pos = last;
+        for (auto entity : other) {
+            if (pos == first) {
+                break;
+            }
+            if (contain(entity)) {
+                auto idx = index(entity);
+                if (idx >= first && idx < pos) {
+                    --pos;
+                    if (idx != pos) {
+                        pump(entity, packed_[pos]);
+                    }
+                }
+            }
+        }
+    }
+
     //! @brief get the entity index in packed
     size_t index(entity_type entity) const noexcept {
         auto id = internal::entity_id(entity);
@@ -189,6 +280,51 @@ public:
         }
     }
 
+    //! @brief test up to 64 entities at once
+    //! @return a mask whose bit i is set when entities[i] is in the set
+    uint64_t contain_n(const entity_numeric_type* entities,
+                       size_t count) const noexcept {
+        GECS_ASSERT(count <= 64, "contain_n tests at most 64 entities");
+        uint64_t mask = 0;
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= count; i += 8) {
+            mask |= uint64_t(contain_8(entities + i)) << i;
+        }
+#endif
+        for (; i < count; i++) {
+            mask |= uint64_t(contain(entities[i])) << i;
+        }
+        return mask;
+    }
+
+    //! @brief copy the entities which are in the set to out, keeping their
+    //!        order, out may be the same as entities
+    //! @return the number of entities written
+    size_t intersect(const entity_numeric_type* entities, size_t count,
+                     entity_numeric_type* out) const noexcept {
+        size_t n = 0;
+#if defined(__AVX2__)
+        for (size_t first = 0; first < count; first += 64) {
+            size_t block = std::min<size_t>(count - first, 64);
+            uint64_t mask = contain_n(entities + first, block);
+            while (mask) {
+                size_t bit = static_cast<size_t>(std::countr_zero(mask));
+                mask &= mask - 1;
+                out[n++] = entities[first + bit];
+            }
+        }
+#else
+        // without gathers going through a mask only adds work
+        for (size_t i = 0; i < count; i++) {
+            if (contain(entities[i])) {
+                out[n++] = entities[i];
+            }
+        }
+#endif
+        return n;
+    }
+
     const_iterator begin() const noexcept {
         return internal::sparse_set_iterator<type>{
             &packed_,
@@ -225,20 +361,71 @@ public:
 
     auto capacity() const noexcept { return packed_.capacity(); }
 
-    auto shrink_to_fit() noexcept {
+    //! @brief release unused capacity, and free the pages whose entities
+    //!        were all removed
+    virtual void shrink_to_fit() {
         packed_.shrink_to_fit();
+        for (auto& page : sparse_) {
+            if (page != null_page() &&
+                std::all_of(page, page + page_size(), [](sparse_entry_type pos) {
+                    return pos == null_sparse_data;
+                })) {
+                delete[] page;
+                page = null_page();
+            }
+        }
+        while (!sparse_.empty() && sparse_.back() == null_page()) {
+            sparse_.pop_back();
+        }
         sparse_.shrink_to_fit();
     }
 
-    void clear() noexcept {
+    //! @brief remove all entities, the allocated pages are kept and reset
+    virtual void clear() noexcept {
         packed_.clear();
-        sparse_.clear();
+        for (auto page : sparse_) {
+            if (page != null_page()) {
+                std::fill_n(page, page_size(), null_sparse_data);
+            }
+        }
     }
 
     bool empty() const noexcept { return packed_.empty(); }
 
     void reserve(size_type size) noexcept { packed_.reserve(size); }
 
+    //! @brief make room in the page table for all entity ids up to max_id,
+    //!        the pages themselves are still allocated when first touched
+    void reserve_pages(entity_numeric_type max_id) {
+        if (page(max_id) >= sparse_.size()) {
+            sparse_.resize(page(max_id) + 1u, null_page());
+        }
+    }
+
+    size_t page_size() const noexcept { return page_mask_ + 1u; }
+
+    //! @brief change the page size, the sparse pages are rebuilt from packed
+    //! @param page_size  a power of 2 no larger than max_page_size
+    void set_page_size(size_t page_size) {
+        release_pages();
+        sparse_.clear();
+        init_page_size(page_size);
+        for (size_t pos = 0; pos < packed_.size(); pos++) {
+            auto id = internal::entity_id(packed_[pos]);
+            assure(page(id))[offset(id)] = static_cast<sparse_entry_type>(pos);
+        }
+    }
+
+    //! @brief bytes held by the sparse pages and the page table
+    size_t sparse_bytes() const noexcept {
+        size_t pages = std::count_if(sparse_.begin(), sparse_.end(),
+                                     [this](const sparse_entry_type* page) {
+                                         return page != null_page();
+                                     });
+        return pages * page_size() * sizeof(sparse_entry_type) +
+               sparse_.capacity() * sizeof(sparse_entry_type*);
+    }
+
     const entity_type& back() const noexcept { return packed_.back(); }
 
     auto data() const noexcept { return packed_.data(); }
@@ -261,43 +448,136 @@ public:
             std::as_const(*this).packed());
     }
 
-    virtual ~basic_sparse_set() = default;
+    virtual ~basic_sparse_set() { release_pages(); }
+
+protected:
+    //! @brief move the last entity to pos and drop the tail, derived
+    //!        classes override it to keep their own data in the same order
+    virtual void swap_and_pop(entity_type entity, size_t pos) noexcept {
+        packed_[pos] = std::move(packed_.back());
+        sparse_ref(internal::entity_id(packed_[pos])) =
+            static_cast<sparse_entry_type>(pos);
+        sparse_ref(internal::entity_id(entity)) = null_sparse_data;
+        packed_.pop_back();
+    }
+
+    //! @brief called before two packed entities swap their positions,
+    //!        derived classes override it to swap their own data
+    virtual void swap_at(size_t, size_t) noexcept {}
 
 private:
     packed_container_type packed_;
     sparse_container_type sparse_;
+    size_t page_shift_ = 0;
+    size_t page_mask_ = 0;
+
+    // pages that were never written point here, it is never written either
+    // since assure() replaces it before any write
+    static constexpr std::array<sparse_entry_type, max_page_size> null_page_ =
+        [] {
+            std::array<sparse_entry_type, max_page_size> page{};
+            for (auto& pos : page) {
+                pos = null_sparse_data;
+            }
+            return page;
+        }();
 
-    size_t page(entity_numeric_type id) const noexcept { return id / PageSize; }
+    static sparse_entry_type* null_page() noexcept {
+        return const_cast<sparse_entry_type*>(null_page_.data());
+    }
 
-    size_t offset(entity_numeric_type id) const noexcept {
-        return id % PageSize;
+#if defined(__AVX2__)
+    // contain() for 8 entities: gather the page pointers, then the sparse
+    // entries, then the packed entities, lanes which can't match are masked
+    // off so nothing out of range is read
+    uint8_t contain_8(const entity_numeric_type* entities) const noexcept {
+        static_assert(sizeof(entity_numeric_type) == 4 &&
+                      sizeof(sparse_entry_type) == 4);
+        using traits = internal::entity_traits<entity_type>;
+        const __m256i entity =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entities));
+        const __m256i id = _mm256_and_si256(
+            entity, _mm256_set1_epi32(static_cast<int>(traits::entity_mask)));
+        const __m256i page = _mm256_srl_epi32(
+            id, _mm_cvtsi64_si128(static_cast<long long>(page_shift_)));
+        const __m256i offset = _mm256_and_si256(
+            id, _mm256_set1_epi32(static_cast<int>(page_mask_)));
+        const __m256i in_table = _mm256_cmpgt_epi32(
+            _mm256_set1_epi32(static_cast<int>(sparse_.size())), page);
+
+        const auto* table = reinterpret_cast<const long long*>(sparse_.data());
+        auto gather_pos = [&](__m128i page, __m128i offset, __m128i mask) {
+            __m256i ptr = _mm256_mask_i32gather_epi64(
+                _mm256_setzero_si256(), table, page,
+                _mm256_cvtepi32_epi64(mask), 8);
+            __m256i addr = _mm256_add_epi64(
+                ptr, _mm256_slli_epi64(_mm256_cvtepu32_epi64(offset), 2));
+            return _mm256_mask_i64gather_epi32(
+                _mm_set1_epi32(-1), static_cast<const int*>(nullptr), addr,
+                mask, 1);
+        };
+        const __m256i pos = _mm256_set_m128i(
+            gather_pos(_mm256_extracti128_si256(page, 1),
+                       _mm256_extracti128_si256(offset, 1),
+                       _mm256_extracti128_si256(in_table, 1)),
+            gather_pos(_mm256_castsi256_si128(page),
+                       _mm256_castsi256_si128(offset),
+                       _mm256_castsi256_si128(in_table)));
+
+        const __m256i valid = _mm256_andnot_si256(
+            _mm256_cmpeq_epi32(pos, _mm256_set1_epi32(-1)), in_table);
+        const __m256i stored = _mm256_mask_i32gather_epi32(
+            _mm256_setzero_si256(), reinterpret_cast<const int*>(packed_.data()),
+            pos, valid, 4);
+        const __m256i found =
+            _mm256_and_si256(_mm256_cmpeq_epi32(stored, entity), valid);
+        return static_cast<uint8_t>(
+            _mm256_movemask_ps(_mm256_castsi256_ps(found)));
+    }
+#endif
+
+    void init_page_size(size_t page_size) noexcept {
+        GECS_ASSERT(is_power_of_2(page_size) && page_size <= max_page_size,
+                    "page size must be a power of 2 and at most max_page_size");
+        page_shift_ = 0;
+        while ((size_t(1) << page_shift_) < page_size) {
+            page_shift_++;
+        }
+        page_mask_ = page_size - 1u;
     }
 
-    const size_t* sparse_ptr(entity_numeric_type id) const noexcept {
-        auto page = this->page(id);
-        return page < sparse_.size() ? &sparse_[page][offset(id)] : nullptr;
+    void release_pages() noexcept {
+        for (auto& page : sparse_) {
+            if (page != null_page()) {
+                delete[] page;
+                page = null_page();
+            }
+        }
     }
 
-    const size_t& sparse_ref(entity_numeric_type id) const noexcept {
-        return sparse_[page(id)][offset(id)];
+    size_t page(entity_numeric_type id) const noexcept {
+        return id >> page_shift_;
+    }
+
+    size_t offset(entity_numeric_type id) const noexcept {
+        return id & page_mask_;
     }
 
-    size_t* sparse_ptr(entity_numeric_type id) noexcept {
-        return const_cast<size_t*>(std::as_const(*this).sparse_ptr(id));
+    const sparse_entry_type& sparse_ref(entity_numeric_type id) const noexcept {
+        return sparse_[page(id)][offset(id)];
     }
 
-    size_t& sparse_ref(entity_numeric_type id) noexcept {
-        return const_cast<size_t&>(std::as_const(*this).sparse_ref(id));
+    sparse_entry_type& sparse_ref(entity_numeric_type id) noexcept {
+        return const_cast<sparse_entry_type&>(std::as_const(*this).sparse_ref(id));
     }
 
-    auto& assure(size_type page) noexcept {
+    sparse_entry_type* assure(size_type page) {
         if (page >= sparse_.size()) {
-            auto old_size = sparse_.size();
-            sparse_.resize(page + 1u);
-            for (size_type i = old_size; i < sparse_.size(); i++) {
-                std::uninitialized_fill(std::begin(sparse_[i]),
-                                        std::end(sparse_[i]), null_sparse_data);
-            }
+            sparse_.resize(page + 1u, null_page());
+        }
+        if (sparse_[page] == null_page()) {
+            sparse_[page] = new sparse_entry_type[page_size()];
+            std::fill_n(sparse_[page], page_size(), null_sparse_data);
         }
         return sparse_[page];
     }
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "cppecs/sparse_set.hpp"
+#include "cppecs/tick.hpp"
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cppecs {
+
+/**
+ * @brief sparse set which keeps a component for each entity, the component
+ *        at payload()[i] and it's ticks at ticks()[i] always belong to the
+ *        entity at packed()[i]
+ * @tparam EntityT  the entity type
+ * @tparam Type  the component type
+ * @tparam PageSize  the default page size of the sparse pages
+ **/
+template <typename EntityT, typename Type, size_t PageSize>
+class basic_storage : public basic_sparse_set<EntityT, PageSize> {
+public:
+    using base_type = basic_sparse_set<EntityT, PageSize>;
+    using entity_type = EntityT;
+    using value_type = Type;
+    using payload_container_type = std::vector<Type>;
+    using ticks_container_type = std::vector<component_ticks>;
+    using size_type = typename base_type::size_type;
+
+    explicit basic_storage(size_t page_size = PageSize) noexcept
+        : base_type(page_size) {}
+
+    //! @brief insert an entity and construct it's component in place
+    template <typename... Args>
+    Type& emplace(entity_type entity, Args&&... args) {
+        GECS_ASSERT(!base_type::contain(entity), "entity already in storage");
+
+        if constexpr (std::is_aggregate_v<Type>) {
+            payload_.push_back(Type{std::forward<Args>(args)...});
+        } else {
+            payload_.emplace_back(std::forward<Args>(args)...);
+        }
+        ticks_.emplace_back();
+        base_type::insert(entity);
+        return payload_.back();
+    }
+
+    //! @brief get the component of an entity
+    const Type& get(entity_type entity) const noexcept {
+        GECS_ASSERT(base_type::contain(entity), "entity not in storage");
+        return payload_[base_type::index(entity)];
+    }
+
+    Type& get(entity_type entity) noexcept {
+        return const_cast<Type&>(std::as_const(*this).get(entity));
+    }
+
+    const payload_container_type& payload() const noexcept { return payload_; }
+
+    payload_container_type& payload() noexcept { return payload_; }
+
+    //! @brief get the ticks of an entity's component
+    component_ticks& ticks(entity_type entity) noexcept {
+        GECS_ASSERT(base_type::contain(entity), "entity not in storage");
+        return ticks_[base_type::index(entity)];
+    }
+
+    const ticks_container_type& ticks() const noexcept { return ticks_; }
+
+    ticks_container_type& ticks() noexcept { return ticks_; }
+
+    void reserve(size_type size) {
+        base_type::reserve(size);
+        payload_.reserve(size);
+        ticks_.reserve(size);
+    }
+
+    void clear() noexcept override {
+        payload_.clear();
+        ticks_.clear();
+        base_type::clear();
+    }
+
+    void shrink_to_fit() override {
+        payload_.shrink_to_fit();
+        ticks_.shrink_to_fit();
+        base_type::shrink_to_fit();
+    }
+
+protected:
+    void swap_and_pop(entity_type entity, size_t pos) noexcept override {
+        if (pos + 1u != payload_.size()) {
+            payload_[pos] = std::move(payload_.back());
+            ticks_[pos] = ticks_.back();
+        }
+        payload_.pop_back();
+        ticks_.pop_back();
+        base_type::swap_and_pop(entity, pos);
+    }
+
+    void swap_at(size_t lhs, size_t rhs) noexcept override {
+        using std::swap;
+        swap(payload_[lhs], payload_[rhs]);
+        swap(ticks_[lhs], ticks_[rhs]);
+    }
+
+private:
+    payload_container_type payload_;
+    ticks_container_type ticks_;
+};
+
+}  // namespace cppecs
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cppecs {
+
+/**
+ * @brief work stealing thread pool, every worker owns a task queue and
+ *        steals from the others when it's own queue is empty
+ **/
+class thread_pool final {
+public:
+    using task_type = std::function<void()>;
+
+    //! @param workers  number of worker threads, the thread calling wait()
+    //!                 runs tasks too
+    explicit thread_pool(size_t workers);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    size_t size() const noexcept { return queues_.size(); }
+
+    //! @brief push a task, tasks submitted from a worker go to it's own
+    //!        queue, others are spread over all queues
+    void submit(task_type task);
+
+    //! @brief run one queued task on the calling thread
+    //! @return false if no task was found
+    bool try_run_one();
+
+    //! @brief run queued tasks on the calling thread until done() is true,
+    //!        safe to call from inside a task
+    template <typename Pred>
+    void wait(Pred&& done) {
+        while (!done()) {
+            if (!try_run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<task_type> tasks;
+    };
+
+    bool pop(size_t index, task_type& task);
+    bool steal(size_t thief, task_type& task);
+    void worker_loop(size_t index);
+
+    std::vector<std::unique_ptr<queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+};
+
+}  // namespace cppecs
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cppecs {
+
+using tick_type = uint32_t;
+
+//! @brief the ticks when a component was added and last changed
+struct component_ticks {
+    tick_type added = 0;
+    tick_type changed = 0;
+};
+
+//! @brief whether tick happened after last_run, seen from this_run
+//!        compared by distance to this_run, so the counter may wrap around
+//!        as long as ticks are less than 2^31 apart
+constexpr bool tick_newer(tick_type tick, tick_type last_run,
+                          tick_type this_run) noexcept {
+    return static_cast<tick_type>(this_run - tick) <
+           static_cast<tick_type>(this_run - last_run);
+}
+
+}  // namespace cppecs
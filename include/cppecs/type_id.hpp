@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace cppecs {
+
+using type_hash_type = uint64_t;
+
+namespace internal {
+
+template <typename T>
+constexpr std::string_view raw_type_name() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
+}
+
+// the compiler wraps the type name in a fixed prefix and suffix,
+// measure them once with a known type whose name doesn't appear elsewhere
+// in the signature
+inline constexpr std::string_view probe_type_name = raw_type_name<double>();
+inline constexpr size_t type_name_prefix = probe_type_name.find("double");
+inline constexpr size_t type_name_suffix =
+    probe_type_name.size() - type_name_prefix - 6;
+static_assert(type_name_prefix != std::string_view::npos,
+              "unsupported compiler for type_name");
+
+constexpr type_hash_type fnv1a(std::string_view str) noexcept {
+    type_hash_type hash = 14695981039346656037ull;
+    for (char c : str) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace internal
+
+//! @brief the name of T as spelled by the compiler, e.g. "Position" or
+//!        "struct Position" with MSVC
+template <typename T>
+constexpr std::string_view type_name() noexcept {
+    constexpr std::string_view raw = internal::raw_type_name<T>();
+    return raw.substr(internal::type_name_prefix,
+                      raw.size() - internal::type_name_prefix -
+                          internal::type_name_suffix);
+}
+
+//! @brief a hash of the type name, computed at compile time
+//!        it doesn't depend on the order types are used in, so it stays the
+//!        same across builds and runs with the same compiler
+template <typename T>
+constexpr type_hash_type type_hash() noexcept {
+    return internal::fnv1a(type_name<T>());
+}
+
+}  // namespace cppecs
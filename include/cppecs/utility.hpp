@@ -13,7 +13,7 @@ namespace cppecs {
 #endif
 
 inline constexpr size_t is_power_of_2(size_t number) {
-    return number && ((number - 1) & (number == 0));
+    return number && ((number & (number - 1)) == 0);
 }
 
 template <typename T>
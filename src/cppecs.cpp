@@ -5,37 +5,131 @@
 namespace cppecs {
 
 void World::StartUp() {
-    std::shared_ptr<Commands> commands = createCommands();
-    Queryer queryer(*this);
+    if (!m_startUpCommands) {
+        m_startUpCommands = createCommands();
+    }
     for (auto& sys : m_startUpSystems) {
-        sys(*commands, queryer);
+        Tick tick = nextTick();
+        Queryer queryer(*this, 0, tick, nullptr);
+        m_startUpCommands->setRunTicks(0, tick);
+        sys(*m_startUpCommands, queryer);
     }
 }
 
 void World::Update() {
-    std::shared_ptr<Commands> commands = createCommands();
-    Queryer queryer(*this);
-    for (auto& sys : m_systems) {
-        sys(*commands, queryer);
+    runSystems();
+
+    executeCommands();
+}
+
+void World::buildSchedule() {
+    m_parallel = false;
+    for (auto& info : m_systems) {
+        info.m_dependents.clear();
+        info.m_dependencyCount = 0;
+    }
+    for (size_t j = 0; j < m_systems.size(); j++) {
+        SystemInfo& later = m_systems[j];
+        for (size_t i = 0; i < j; i++) {
+            SystemInfo& earlier = m_systems[i];
+            if (earlier.m_exclusive || later.m_exclusive || earlier.m_access.Conflict(later.m_access)) {
+                earlier.m_dependents.push_back(j);
+                later.m_dependencyCount++;
+            } else {
+                m_parallel = true;
+            }
+        }
     }
+    m_scheduleDirty = false;
+}
 
-    for (auto commands : m_commands) {
-        commands->Execute();
+thread_pool* World::assureThreadPool() {
+    if (!m_threadPool) {
+        size_t count = m_threadCount ? m_threadCount : std::thread::hardware_concurrency();
+        if (count <= 1) {
+            return nullptr;
+        }
+        //调用Update的线程也会运行系统
+        m_threadPool = std::make_unique<thread_pool>(count - 1);
     }
-    destoryCommands();
+    return m_threadPool.get();
 }
 
-std::shared_ptr<Commands> World::createCommands() {
-    if (!m_commandsCache.empty()) {
-        m_commands.push_back(m_commandsCache.back());
-        m_commandsCache.pop_back();
-    } else {
-        std::shared_ptr<Commands> commands;
-        commands.reset(new Commands(*this));
-        m_commands.push_back(commands);
+void World::runSystem(SystemInfo& info) {
+    //每次运行取一个新的tick, Added/Changed只看上次运行之后的修改
+    Tick tick = nextTick();
+    Queryer queryer(*this, info.m_lastRunTick, tick, &info.m_eventCursors);
+    info.m_commands->setRunTicks(info.m_lastRunTick, tick);
+    info.m_system(*info.m_commands, queryer);
+    info.m_lastRunTick = tick;
+}
+
+void World::runSystems() {
+    if (m_scheduleDirty) {
+        buildSchedule();
+    }
+
+    size_t count = m_systems.size();
+    thread_pool* pool = m_parallel ? assureThreadPool() : nullptr;
+    if (!pool) {
+        for (size_t i = 0; i < count; i++) {
+            runSystem(m_systems[i]);
+        }
+        return;
     }
-    return m_commands.back();
+
+    //依赖都完成的系统提交到线程池, 当前线程一边等待一边运行任务
+    std::unique_ptr<std::atomic<size_t>[]> remaining(new std::atomic<size_t>[count]);
+    for (size_t i = 0; i < count; i++) {
+        remaining[i] = m_systems[i].m_dependencyCount;
+    }
+    std::atomic<size_t> finished {0};
+    std::function<void(size_t)> run = [&](size_t i) {
+        runSystem(m_systems[i]);
+        for (size_t dependent : m_systems[i].m_dependents) {
+            if (remaining[dependent].fetch_sub(1) == 1) {
+                pool->submit([&run, dependent]() { run(dependent); });
+            }
+        }
+        finished.fetch_add(1);
+    };
+    for (size_t i = 0; i < count; i++) {
+        if (m_systems[i].m_dependencyCount == 0) {
+            pool->submit([&run, i]() { run(i); });
+        }
+    }
+    pool->wait([&finished, count]() { return finished.load() == count; });
 }
 
+void World::executeCommands() {
+    //按阶段合并, 和所有系统共用一个命令缓冲时的结果相同, 见World::Update
+    auto forEachCommands = [this](void (Commands::*execute)()) {
+        if (m_startUpCommands) {
+            (m_startUpCommands.get()->*execute)();
+        }
+        for (auto& info : m_systems) {
+            (info.m_commands.get()->*execute)();
+        }
+    };
+    m_commandTick = nextTick();
+    forEachCommands(&Commands::executeDestroyEntities);
+    forEachCommands(&Commands::executeDestroyResources);
+    forEachCommands(&Commands::executeSpawnEntities);
+    forEachCommands(&Commands::executeChangeComponents);
+    forEachCommands(&Commands::executeCreateResources);
+
+    //交换之后再追加, 这一帧发送的事件保留到下下次交换
+    for (auto& events : m_events) {
+        if (events) {
+            events->Swap();
+        }
+    }
+    forEachCommands(&Commands::executeSendEvents);
+}
 
-}
\ No newline at end of file
+std::shared_ptr<Commands> World::createCommands() {
+    return std::shared_ptr<Commands>(new Commands(*this));
+}
+
+
+}
@@ -0,0 +1,104 @@
+#include "cppecs/thread_pool.hpp"
+
+namespace cppecs {
+
+namespace {
+
+// the pool the current thread works for and it's queue index
+thread_local const thread_pool* tl_pool = nullptr;
+thread_local size_t tl_index = static_cast<size_t>(-1);
+
+}  // namespace
+
+thread_pool::thread_pool(size_t workers) {
+    if (workers == 0) {
+        workers = 1;
+    }
+    queues_.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        queues_.push_back(std::make_unique<queue>());
+    }
+    threads_.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        threads_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void thread_pool::submit(task_type task) {
+    size_t index = tl_pool == this
+                       ? tl_index
+                       : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                             queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+bool thread_pool::try_run_one() {
+    task_type task;
+    size_t index = tl_pool == this ? tl_index : 0;
+    if ((tl_pool == this && pop(index, task)) || steal(index, task)) {
+        queued_.fetch_sub(1);
+        task();
+        return true;
+    }
+    return false;
+}
+
+bool thread_pool::pop(size_t index, task_type& task) {
+    auto& q = *queues_[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool thread_pool::steal(size_t thief, task_type& task) {
+    for (size_t i = 0; i < queues_.size(); i++) {
+        auto& q = *queues_[(thief + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void thread_pool::worker_loop(size_t index) {
+    tl_pool = this;
+    tl_index = index;
+    while (true) {
+        if (try_run_one()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+}  // namespace cppecs
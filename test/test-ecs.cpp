@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <thread>
 
 #include "cppecs/cppecs.hpp"
 
@@ -54,7 +55,11 @@ void destroySystem1(Commands& commands, Queryer& queryer) {
 }
 
 void Cppunit_tests::testEntity() {
-	World world;
+	checkEntity(StorageMode::SparseSet);
+}
+
+void Cppunit_tests::checkEntity(StorageMode storageMode) {
+	World world(storageMode);
 	world.StartUp();
 
 	{
@@ -82,6 +87,19 @@ void Cppunit_tests::testEntity() {
 	CHECK(queryer.Query<Name>().size(), 3);
 	CHECK((queryer.Query<Name, ID>().size()), 1);
 
+	{
+		auto view = queryer.View<Name, ID>();
+		CHECK(std::distance(view.begin(), view.end()), 1);
+		CHECK(*view.begin(), entities[2]);
+		CHECK((queryer.Query<ID, Name>().size()), 1);
+		CHECK((queryer.Query<ID, Name>()[0]), entities[2]);
+
+		int count = 0;
+		queryer.View<Name>().each([&count](Entity) { count++; });
+		CHECK(count, 3);
+		CHECKT(queryer.View<Timer>().empty());
+	}
+
 	{
 		world.AddSystem(destroySystem1);
 		world.Update();
@@ -127,6 +145,21 @@ void removeResourceSystem1(Commands& commands, Queryer& queryer) {
 };
 
 
+struct ResLarge {
+	std::array<int, 256> values;
+	std::string name;
+};
+
+void setResourceSystem3(Commands& commands, Queryer& queryer) {
+	ResLarge res;
+	for (int i = 0; i < 256; i++) {
+		res.values[i] = i;
+	}
+	res.name = "large";
+	commands.SetResource(std::move(res));
+}
+
+
 void Cppunit_tests::testResource() {
 	World world;
 	Queryer queryer(world);
@@ -147,6 +180,37 @@ void Cppunit_tests::testResource() {
 		world.RemoveSystem(removeResourceSystem1);
 	}
 	CHECKT(!queryer.HasResource<Timer>());
+
+	//小的资源放在World的槽里, 大的资源单独分配, 创建别的资源后地址都不变
+	{
+		world.AddSystem(setResourceSystem3);
+		world.Update();
+		world.RemoveSystem(setResourceSystem3);
+	}
+	CHECKT(queryer.HasResource<ResLarge>());
+	CHECKT(!queryer.HasResource<Timer>());
+	auto& large = queryer.GetResource<ResLarge>();
+	CHECK(large.values[255], 255);
+	CHECKT(large.name == "large");
+
+	{
+		world.AddSystem(setResourceSystem2);
+		world.Update();
+		world.RemoveSystem(setResourceSystem2);
+	}
+	CHECKT(&queryer.GetResource<ResLarge>() == &large);
+	auto& timer2 = queryer.GetResource<Timer>();
+	CHECK(timer2.t, 1);
+	CHECKT(&timer2 == &timer);
+
+	{
+		world.AddSystem(removeResourceSystem1);
+		world.Update();
+		world.RemoveSystem(removeResourceSystem1);
+	}
+	CHECKT(!queryer.HasResource<Timer>());
+	CHECKT(queryer.HasResource<ResLarge>());
+	CHECKT(&queryer.GetResource<ResLarge>() == &large);
 }
 
 struct TestRsult {
@@ -206,6 +270,31 @@ void checkSystem1 (Commands& commands, Queryer& queryer) {
 		ADD_CHECKD(tresults, (it != ids.cend()), (id+" not found"));
 	}
 
+	int eachCount = 0;
+	queryer.Each<const Name, ID>([&](Entity entity, const Name& name, ID& id) {
+		eachCount++;
+		ADD_CHECK(tresults, &queryer.Get<ID>(entity) == &id);
+		ADD_CHECK(tresults, queryer.Get<Name>(entity).name == name.name);
+	});
+	ADD_CHECK(tresults, eachCount == 2);
+
+	ADD_CHECK(tresults, (queryer.Query<Name, Without<ID>>().size() == 1));
+	ADD_CHECK(tresults, (queryer.Query<Without<Name>, ID>().size() == 1));
+	ADD_CHECK(tresults, (queryer.Query<Name, Without<Timer>>().size() == 3));
+
+	int optionalCount = 0;
+	int optionalHas = 0;
+	queryer.Each<Name, Optional<const ID>>([&](Entity entity, Name& name, const ID* id) {
+		optionalCount++;
+		if (id) {
+			optionalHas++;
+			ADD_CHECK(tresults, &queryer.Get<ID>(entity) == id);
+		}
+		ADD_CHECK(tresults, (id != nullptr) == queryer.Has<ID>(entity));
+	});
+	ADD_CHECK(tresults, optionalCount == 3);
+	ADD_CHECK(tresults, optionalHas == 2);
+
 	std::vector<Entity> entities3 = queryer.Query<Name, ID>();
 	ADD_CHECK(tresults, entities3.size()==2);
 	{
@@ -223,7 +312,11 @@ void checkSystem1 (Commands& commands, Queryer& queryer) {
 }
 
 void Cppunit_tests::testSystem() {
-	World world;
+	checkSystem(StorageMode::SparseSet);
+}
+
+void Cppunit_tests::checkSystem(StorageMode storageMode) {
+	World world(storageMode);
 
 	world.StartUp();
 
@@ -248,6 +341,1149 @@ void Cppunit_tests::testSystem() {
 	}
 }
 
+void Cppunit_tests::testStorage() {
+	basic_storage<Entity, ID, 32> storage;
+	for (Entity entity = 1; entity <= 100; entity++) {
+		storage.emplace(entity, ID{(int)entity});
+	}
+	CHECK(storage.size(), 100);
+	CHECK(storage.payload().size(), 100);
+
+	for (Entity entity = 1; entity <= 100; entity += 3) {
+		storage.remove(entity);
+	}
+	CHECK(storage.size(), 66);
+	CHECK(storage.payload().size(), 66);
+
+	bool inOrder = true;
+	for (size_t i = 0; i < storage.packed().size(); i++) {
+		inOrder = inOrder && storage.payload()[i].id == (int)storage.packed()[i];
+	}
+	CHECKT(inOrder);
+	CHECKT(!storage.contain(1));
+	CHECK(storage.get(2).id, 2);
+	CHECK(storage.get(99).id, 99);
+}
+
+void Cppunit_tests::testSparsePages() {
+	using Set = basic_sparse_set<Entity, 32>;
+	static_assert(sizeof(Set::sparse_entry_type) == 4);
+
+	//只有写入的页才分配, 其余的页共享一个空页
+	Set set;
+	set.insert(5);
+	set.insert(100000);
+	CHECKT(set.contain(5));
+	CHECKT(set.contain(100000));
+	CHECKT(!set.contain(6));
+	CHECKT(!set.contain(50000));
+	CHECKT(!set.contain(1000000));
+	size_t table = (100000 / 32 + 1) * sizeof(Set::sparse_entry_type*);
+	CHECKT(set.sparse_bytes() >= table + 2 * 32 * sizeof(Set::sparse_entry_type));
+	CHECKT(set.sparse_bytes() < table * 2 + 2 * 32 * sizeof(Set::sparse_entry_type));
+
+	//换页大小后按packed重建
+	basic_storage<Entity, ID, 32> storage;
+	for (Entity entity = 0; entity < 1000; entity += 7) {
+		storage.emplace(entity, ID{(int)entity});
+	}
+	storage.set_page_size(256);
+	CHECK(storage.page_size(), 256);
+	bool found = true;
+	for (Entity entity = 0; entity < 1000; entity++) {
+		found = found && storage.contain(entity) == (entity % 7 == 0);
+	}
+	CHECKT(found);
+	CHECK(storage.get(994).id, 994);
+
+	//实体都删掉的页在shrink_to_fit时释放, 末尾的空页从页表中去掉
+	for (Entity entity = 259; entity < 1000; entity += 7) {
+		storage.remove(entity);
+	}
+	size_t before = storage.sparse_bytes();
+	storage.shrink_to_fit();
+	CHECK(storage.sparse_bytes(), 256 * sizeof(Set::sparse_entry_type) + sizeof(Set::sparse_entry_type*));
+	CHECKT(storage.sparse_bytes() < before);
+	CHECK(storage.get(252).id, 252);
+	CHECKT(!storage.contain(259));
+
+	//clear保留已分配的页
+	storage.clear();
+	CHECKT(!storage.contain(0));
+	CHECK(storage.sparse_bytes(), 256 * sizeof(Set::sparse_entry_type) + sizeof(Set::sparse_entry_type*));
+	storage.emplace(3, ID{3});
+	CHECK(storage.get(3).id, 3);
+
+	//World按组件设置页大小
+	World world;
+	world.SetPageSize<ID>(1024);
+	world.AddSystem(spawnSystem2);
+	world.Update();
+	world.SetPageSize<Name>(8);
+	Queryer queryer(world);
+	CHECK((queryer.Query<Name, ID>().size()), 2);
+	CHECK(queryer.Query<Name>().size(), 3);
+	world.ShrinkToFit();
+	CHECK(queryer.Query<ID>().size(), 3);
+}
+
+void Cppunit_tests::testContainN() {
+	using Set = basic_sparse_set<Entity, 32>;
+	Set set;
+	for (Entity entity = 0; entity < 2000; entity += 3) {
+		set.insert(entity);
+	}
+	for (Entity entity = 0; entity < 2000; entity += 9) {
+		set.remove(entity);
+	}
+	//旧版本的实体不算在集合中
+	Entity stale = internal::entity_inc_version(Entity(3));
+
+	//超出页表的ID, 空页中的ID, 删除过的ID, 旧版本, 数量不是8的倍数
+	std::vector<Entity> entities;
+	for (Entity entity = 0; entity < 2100; entity++) {
+		entities.push_back(entity);
+	}
+	entities.push_back(stale);
+	entities.push_back(100000);
+
+	bool same = true;
+	for (size_t first = 0; first < entities.size(); first += 61) {
+		size_t count = std::min<size_t>(entities.size() - first, 61);
+		uint64_t mask = set.contain_n(entities.data() + first, count);
+		for (size_t i = 0; i < 64; i++) {
+			bool expected = i < count && set.contain(entities[first + i]);
+			same = same && ((mask >> i) & 1) == expected;
+		}
+	}
+	CHECKT(same);
+
+	std::vector<Entity> out(entities.size());
+	size_t n = set.intersect(entities.data(), entities.size(), out.data());
+	out.resize(n);
+	std::vector<Entity> expected;
+	for (Entity entity : entities) {
+		if (set.contain(entity)) {
+			expected.push_back(entity);
+		}
+	}
+	CHECKT(out == expected);
+	CHECK(n, 2000 / 3 + 1 - (2000 / 9 + 1));
+
+	//原地过滤
+	n = set.intersect(entities.data(), entities.size(), entities.data());
+	entities.resize(n);
+	CHECKT(entities == expected);
+
+	Set empty;
+	CHECK(empty.contain_n(expected.data(), std::min<size_t>(expected.size(), 64)), 0);
+	CHECK(empty.intersect(expected.data(), expected.size(), out.data()), 0);
+}
+
+struct ResSort {
+	int count {0};
+};
+
+void spawnSortSystem(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResSort>();
+	for (int i = 0; i < res.count; i++) {
+		//打乱的键, 每3个实体有一个没有Timer, 每5个有一个没有Name
+		int key = (i * 37) % res.count;
+		if (i % 3 == 0) {
+			commands.Spawn<Name, ID>(Name{"person" + std::to_string(key)}, ID{key});
+		} else if (i % 5 == 0) {
+			commands.Spawn<ID, Timer>(ID{key}, Timer{key});
+		} else {
+			commands.Spawn<Name, ID, Timer>(Name{"person" + std::to_string(key)}, ID{key}, Timer{key});
+		}
+	}
+}
+
+void setResourceSort(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResSort>(ResSort{100});
+}
+
+void destroySortSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<const ID>([&commands](Entity entity, const ID& id) {
+		if (id.id % 2 == 0) {
+			commands.Destroy(entity);
+		}
+	});
+}
+
+size_t countDescents(const std::vector<int>& values) {
+	size_t count = 0;
+	for (size_t i = 1; i < values.size(); i++) {
+		count += values[i] < values[i - 1];
+	}
+	return count;
+}
+
+void Cppunit_tests::testSort() {
+	//组件和ticks随实体一起移动
+	basic_storage<Entity, ID, 32> storage;
+	for (Entity entity = 0; entity < 200; entity++) {
+		storage.emplace(entity, ID{int((entity * 37) % 200)});
+		storage.ticks(entity).added = entity;
+	}
+	storage.sort([&storage](Entity lhs, Entity rhs) {
+		return storage.get(lhs).id < storage.get(rhs).id;
+	});
+	bool consistent = true;
+	int last = -1;
+	for (Entity entity : storage) {
+		consistent = consistent && storage.get(entity).id > last;
+		consistent = consistent && storage.get(entity).id == int((entity * 37) % 200);
+		consistent = consistent && storage.ticks(entity).added == entity;
+		last = storage.get(entity).id;
+	}
+	CHECKT(consistent);
+
+	//只排序packed的一段, 范围外的实体不动
+	std::vector<Entity> before(storage.packed().begin(), storage.packed().end());
+	storage.sort(50, 100, [](Entity lhs, Entity rhs) { return lhs < rhs; });
+	bool ranged = true;
+	for (size_t pos = 0; pos < storage.size(); pos++) {
+		if (pos < 50 || pos >= 100) {
+			ranged = ranged && storage.packed()[pos] == before[pos];
+		} else if (pos > 50) {
+			ranged = ranged && storage.packed()[pos] < storage.packed()[pos - 1];
+		}
+		ranged = ranged && storage.index(storage.packed()[pos]) == pos;
+		ranged = ranged && storage.payload()[pos].id == int((storage.packed()[pos] * 37) % 200);
+	}
+	CHECKT(ranged);
+
+	//同时存在的实体按other的遍历顺序最先遍历
+	basic_storage<Entity, Timer, 32> other;
+	for (Entity entity = 0; entity < 300; entity += 2) {
+		other.emplace(entity, Timer{int(entity)});
+	}
+	other.respect(storage);
+	std::vector<Entity> expected;
+	for (Entity entity : storage) {
+		if (other.contain(entity)) {
+			expected.push_back(entity);
+		}
+	}
+	std::vector<Entity> visited;
+	for (Entity entity : other) {
+		if (visited.size() < expected.size()) {
+			visited.push_back(entity);
+		}
+	}
+	CHECKT(visited == expected);
+	bool following = true;
+	for (Entity entity : other) {
+		following = following && other.get(entity).t == int(entity);
+	}
+	CHECKT(following);
+
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		Queryer queryer(world);
+		world.AddSystem(setResourceSort);
+		world.Update();
+		world.RemoveSystem(setResourceSort);
+		world.AddGroup<Name, ID>();
+		world.AddSystem(spawnSortSystem);
+		world.Update();
+		world.RemoveSystem(spawnSortSystem);
+
+		//group内外各自有序, archetype每张表各自有序
+		bool sparse = storageMode == StorageMode::SparseSet;
+		world.Sort<ID>([](const ID& lhs, const ID& rhs) { return lhs.id < rhs.id; });
+		std::vector<int> ids;
+		queryer.Each<const ID>([&ids](const ID& id) { ids.push_back(id.id); });
+		CHECK(ids.size(), 100);
+		CHECKT(countDescents(ids) <= (sparse ? 1 : 2));
+
+		//group内的其它组件跟着移动
+		ids.clear();
+		bool grouped = true;
+		queryer.Group<const Name, const ID>().each([&](Entity entity, const Name& name, const ID& id) {
+			ids.push_back(id.id);
+			grouped = grouped && name.name == "person" + std::to_string(id.id);
+			grouped = grouped && &queryer.Get<Name>(entity) == &name;
+		});
+		CHECK(ids.size(), (queryer.Query<Name, ID>().size()));
+		CHECKT(countDescents(ids) <= (sparse ? 0 : 1));
+		CHECKT(grouped);
+
+		//Timer按ID的顺序遍历, 同时拥有两者时内存同步前进
+		world.Respect<Timer, ID>();
+		ids.clear();
+		bool following = true;
+		queryer.Each<const Timer>([&](Entity entity, const Timer& timer) {
+			ids.push_back(timer.t);
+			following = following && queryer.Get<ID>(entity).id == timer.t;
+		});
+		CHECK(ids.size(), (queryer.Query<Timer>().size()));
+		CHECKT(countDescents(ids) <= 1);
+		CHECKT(following);
+
+		//Timer不属于group, 整体有序
+		world.Sort<Timer>([](const Timer& lhs, const Timer& rhs) { return lhs.t > rhs.t; });
+		ids.clear();
+		queryer.Each<const Timer>([&ids](const Timer& timer) { ids.push_back(-timer.t); });
+		CHECKT(countDescents(ids) <= (sparse ? 0 : 1));
+
+		//排序后的增删不受影响
+		world.AddSystem(destroySortSystem);
+		world.Update();
+		world.RemoveSystem(destroySortSystem);
+		CHECK(queryer.Query<ID>().size(), 50);
+		CHECK((queryer.Group<Name, ID>().size()), (queryer.Query<Name, ID>().size()));
+	}
+}
+
+void Cppunit_tests::testArena() {
+	linear_arena arena(256);
+	struct alignas(64) Aligned {
+		int value;
+	};
+	Aligned* aligned = arena.create<Aligned>(Aligned{1});
+	CHECK(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0);
+	Name* name = arena.create<Name>(Name{"person1"});
+	CHECKS(name->name, "person1");
+	name->~Name();
+
+	//超过块大小的分配
+	int* ints = arena.allocate_array<int>(1000);
+	ints[999] = 1;
+	CHECKT(arena.capacity() >= 256 + 1000 * sizeof(int));
+
+	//重置后合并成一块, 之前的用量不再需要新的分配
+	size_t capacity = arena.capacity();
+	arena.reset();
+	CHECK(arena.capacity(), capacity);
+	arena.allocate_array<int>(1000);
+	arena.create<Aligned>(Aligned{2});
+	CHECK(arena.capacity(), capacity);
+}
+
+struct ResRecycle {
+	std::vector<Entity> entities;
+};
+
+void setResourceSystem4(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResRecycle>(ResRecycle{});
+}
+
+void spawnSystem3(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResRecycle>();
+	res.entities.push_back(commands.SpawnAndReturn<ID>(ID{(int)res.entities.size()}));
+}
+
+void destroySystem3(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResRecycle>();
+	commands.Destroy(res.entities.back());
+}
+
+void Cppunit_tests::testEntityRecycle() {
+	World world;
+	Queryer queryer(world);
+
+	{
+		world.AddSystem(setResourceSystem4);
+		world.Update();
+		world.RemoveSystem(setResourceSystem4);
+	}
+	auto& res = queryer.GetResource<ResRecycle>();
+
+	world.AddSystem(spawnSystem3);
+	world.Update();
+	world.RemoveSystem(spawnSystem3);
+
+	Entity first = res.entities.back();
+	CHECKT(queryer.Exist(first));
+
+	for (int i = 0; i < 100; i++) {
+		world.AddSystem(destroySystem3);
+		world.Update();
+		world.RemoveSystem(destroySystem3);
+
+		world.AddSystem(spawnSystem3);
+		world.Update();
+		world.RemoveSystem(spawnSystem3);
+	}
+
+	Entity last = res.entities.back();
+	CHECK(internal::entity_id(last), internal::entity_id(first));
+	CHECK(internal::entity_version(last), 100);
+	CHECKT(!queryer.Exist(first));
+	CHECKT(queryer.Exist(last));
+	CHECKT(!queryer.Has<ID>(first));
+	CHECK(queryer.Get<ID>(last).id, 100);
+	CHECK(queryer.Query<ID>().size(), 1);
+}
+
+void Cppunit_tests::testArchetype() {
+	checkEntity(StorageMode::Archetype);
+	checkSystem(StorageMode::Archetype);
+}
+
+void spawnSystem4(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResRecycle>();
+	for (int i = 0; i < 10; i++) {
+		std::string name = "person" + std::to_string(i);
+		if (i % 3 == 0) {
+			res.entities.push_back(commands.SpawnAndReturn<Name>(Name{name}));
+		} else if (i % 3 == 1) {
+			res.entities.push_back(commands.SpawnAndReturn<ID>(ID{i}));
+		} else {
+			res.entities.push_back(commands.SpawnAndReturn<Name, ID>(Name{name}, ID{i}));
+		}
+	}
+}
+
+void destroySystem4(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResRecycle>();
+	for (size_t i = 0; i < res.entities.size(); i += 2) {
+		commands.Destroy(res.entities[i]);
+	}
+}
+
+void Cppunit_tests::testGroup() {
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		Queryer queryer(world);
+
+		world.AddSystem(setResourceSystem4);
+		world.Update();
+		world.RemoveSystem(setResourceSystem4);
+
+		world.AddSystem(spawnSystem4);
+		world.Update();
+		world.RemoveSystem(spawnSystem4);
+
+		//group注册前已有的实体
+		world.AddGroup<Name, ID>();
+		CHECK((queryer.Group<Name, ID>().size()), 3);
+
+		world.AddSystem(spawnSystem4);
+		world.Update();
+		world.RemoveSystem(spawnSystem4);
+		CHECK((queryer.Group<Name, ID>().size()), 6);
+
+		world.AddSystem(destroySystem4);
+		world.Update();
+		world.RemoveSystem(destroySystem4);
+
+		auto group = queryer.Group<const Name, ID>();
+		CHECK(group.size(), (queryer.Query<Name, ID>().size()));
+
+		bool consistent = true;
+		size_t count = 0;
+		group.each([&](Entity entity, const Name& name, ID& id) {
+			count++;
+			consistent = consistent && queryer.Has<Name>(entity) && queryer.Has<ID>(entity);
+			consistent = consistent && &queryer.Get<ID>(entity) == &id;
+			consistent = consistent && name.name == "person" + std::to_string(id.id);
+		});
+		CHECK(count, group.size());
+		CHECKT(consistent);
+	}
+}
+
+struct ResSchedule {
+	int frames {0};
+	bool consistent {true};
+};
+
+void spawnSystem5(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResSchedule>(ResSchedule{});
+	for (int i = 0; i < 100; i++) {
+		commands.Spawn<ID, Timer>(ID{0}, Timer{0});
+	}
+}
+
+void idSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<ID>([](ID& id) { id.id++; });
+}
+
+void timerSystem(Commands& commands, Queryer& queryer) {
+	queryer.Each<Timer>([](Timer& timer) { timer.t++; });
+}
+
+void nameSystem1(Commands& commands, Queryer& queryer) {
+	for (int i = 0; i < 50; i++) {
+		commands.Spawn<Name>(Name{"a"});
+	}
+}
+
+void nameSystem2(Commands& commands, Queryer& queryer) {
+	for (int i = 0; i < 50; i++) {
+		commands.Spawn<Name>(Name{"b"});
+	}
+}
+
+//依赖idSystem和timerSystem, 必须看到它们这一帧的修改
+void checkSystem5(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResSchedule>();
+	res.frames++;
+	int count = 0;
+	queryer.Each<const ID, const Timer>([&](const ID& id, const Timer& timer) {
+		count++;
+		res.consistent = res.consistent && id.id == res.frames && timer.t == res.frames;
+	});
+	res.consistent = res.consistent && count == 100;
+}
+
+void Cppunit_tests::testSchedule() {
+	CHECKT((SystemAccess().Write<ID>().Conflict(SystemAccess().Read<ID>())));
+	CHECKT((SystemAccess().Read<ID>().Conflict(SystemAccess().Write<Name, ID>())));
+	CHECKT((!SystemAccess().Read<ID>().Conflict(SystemAccess().Read<ID>())));
+	CHECKT((!SystemAccess().Write<ID>().Conflict(SystemAccess().Write<Name>())));
+	CHECKT((SystemAccess().WriteResource<ResSchedule>().Conflict(SystemAccess().ReadResource<ResSchedule>())));
+	CHECKT((!SystemAccess().WriteResource<ID>().Conflict(SystemAccess().Write<ID>())));
+
+	for (size_t threadCount : {1, 4}) {
+		World world;
+		world.SetThreadCount(threadCount);
+		Queryer queryer(world);
+
+		world.AddSystem(spawnSystem5);
+		world.Update();
+		world.RemoveSystem(spawnSystem5);
+
+		world.AddSystem(idSystem, SystemAccess().Write<ID>())
+		     .AddSystem(timerSystem, SystemAccess().Write<Timer>())
+		     .AddSystem(nameSystem1, SystemAccess())
+		     .AddSystem(nameSystem2, SystemAccess())
+		     .AddSystem(checkSystem5, SystemAccess().Read<ID, Timer>().WriteResource<ResSchedule>());
+		for (int i = 0; i < 10; i++) {
+			world.Update();
+		}
+
+		auto& res = queryer.GetResource<ResSchedule>();
+		CHECK(res.frames, 10);
+		CHECKT(res.consistent);
+
+		//并行系统创建的实体全部生效且ID不重复
+		std::vector<Entity> entities = queryer.Query<Name>();
+		CHECK(entities.size(), 1000);
+		std::sort(entities.begin(), entities.end());
+		CHECKT((std::unique(entities.begin(), entities.end()) == entities.end()));
+	}
+}
+
+void spawnSystem6(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResSchedule>(ResSchedule{});
+	for (int i = 0; i < 1000; i++) {
+		if (i % 3 == 0) {
+			commands.Spawn<ID, Timer, Name>(ID{0}, Timer{2}, Name{"person" + std::to_string(i)});
+		} else {
+			commands.Spawn<ID, Timer>(ID{0}, Timer{1});
+		}
+	}
+}
+
+void parEachSystem(Commands& commands, Queryer& queryer) {
+	std::atomic<int> count {0};
+	queryer.ParEach<ID, const Timer>([&count](Entity entity, ID& id, const Timer& timer) {
+		count++;
+		id.id += timer.t;
+	}, 64);
+	queryer.GetResource<ResSchedule>().frames = count;
+}
+
+void parEachCommandsSystem(Commands& commands, Queryer& queryer) {
+	queryer.ParEach<const ID, const Timer>(commands, [](Commands& commands, Entity entity, const ID& id, const Timer& timer) {
+		if (timer.t == 2) {
+			commands.Destroy(entity);
+		} else {
+			commands.Spawn<Name>(Name{std::to_string(entity)});
+		}
+	}, 16);
+}
+
+//线程数不同时, ParEach中记录的命令的执行结果(包括新实体的ID)相同
+std::vector<std::pair<Entity, std::string>> runParEachCommands(StorageMode storageMode, size_t threadCount) {
+	World world(storageMode);
+	world.SetThreadCount(threadCount);
+	Queryer queryer(world);
+
+	world.AddSystem(spawnSystem6);
+	world.Update();
+	world.RemoveSystem(spawnSystem6);
+
+	world.AddSystem(parEachCommandsSystem, SystemAccess().Read<ID, Timer>());
+	world.Update();
+
+	std::vector<std::pair<Entity, std::string>> names;
+	queryer.Each<Name>([&names](Entity entity, Name& name) {
+		names.emplace_back(entity, name.name);
+	});
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+void Cppunit_tests::testParEach() {
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		world.SetThreadCount(4);
+		Queryer queryer(world);
+
+		world.AddSystem(spawnSystem6);
+		world.Update();
+		world.RemoveSystem(spawnSystem6);
+
+		world.AddSystem(parEachSystem, SystemAccess().Write<ID>().Read<Timer>().WriteResource<ResSchedule>());
+		world.Update();
+		CHECK(queryer.GetResource<ResSchedule>().frames, 1000);
+
+		//不在系统中调用, grainSize为1
+		queryer.ParEach<ID>([](ID& id) { id.id *= 10; }, 1);
+
+		bool consistent = true;
+		queryer.Each<const ID, const Timer>([&](const ID& id, const Timer& timer) {
+			consistent = consistent && id.id == timer.t * 10;
+		});
+		CHECKT(consistent);
+
+		//用Get<const T>和Has读取其他实体
+		Entity other = null_entity;
+		queryer.Each<const Name>([&other](Entity entity, const Name&) { other = entity; });
+		std::atomic<int> reads {0};
+		queryer.ParEach<const ID>([&](const ID&) {
+			if (queryer.Has<Name>(other) && queryer.Get<const Timer>(other).t == 2) {
+				reads++;
+			}
+		}, 16);
+		CHECK(reads.load(), 1000);
+
+		auto sequential = runParEachCommands(storageMode, 1);
+		auto parallel = runParEachCommands(storageMode, 4);
+		CHECK(sequential.size(), 666);
+		CHECKT(sequential == parallel);
+	}
+}
+
+void spawnBatchSystem(Commands& commands, Queryer& queryer) {
+	commands.Spawn<Name>(Name{"first"});
+	commands.SpawnBatch<ID, Timer>(1000, [](size_t index, ID& id, Timer& timer) {
+		id.id = (int)index;
+		timer.t = (int)index * 2;
+	});
+	commands.SpawnBatch<Name, ID>(10, [](size_t index, Name& name, ID& id) {
+		name.name = "person" + std::to_string(index);
+		id.id = (int)index;
+	});
+	commands.Spawn<Name>(Name{"last"});
+}
+
+void Cppunit_tests::testSpawnBatch() {
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		world.AddGroup<Name, ID>();
+		Queryer queryer(world);
+
+		//先回收几个ID, 批量创建时优先复用
+		world.AddSystem(setResourceSystem4);
+		world.Update();
+		world.RemoveSystem(setResourceSystem4);
+		world.AddSystem(spawnSystem4);
+		world.Update();
+		world.RemoveSystem(spawnSystem4);
+		world.AddSystem(destroySystem4);
+		world.Update();
+		world.RemoveSystem(destroySystem4);
+
+		world.AddSystem(spawnBatchSystem);
+		world.Update();
+		world.RemoveSystem(spawnBatchSystem);
+
+		CHECK(queryer.Query<Timer>().size(), 1000);
+		CHECK((queryer.Group<Name, ID>().size()), 11);
+
+		bool consistent = true;
+		queryer.Each<const ID, const Timer>([&](Entity entity, const ID& id, const Timer& timer) {
+			consistent = consistent && timer.t == id.id * 2 && queryer.Exist(entity) && !queryer.Has<Name>(entity);
+		});
+		queryer.Group<const Name, const ID>().each([&](const Name& name, const ID& id) {
+			consistent = consistent && (name.name == "person" + std::to_string(id.id));
+		});
+		CHECKT(consistent);
+
+		//执行顺序和记录顺序相同, 回收的ID被复用
+		std::vector<Entity> names = queryer.Query<Name, Without<ID>>();
+		CHECK(names.size(), 4);
+		std::vector<Entity> timers = queryer.Query<Timer>();
+		Entity firstName = null_entity;
+		Entity lastName = null_entity;
+		for (Entity entity : names) {
+			if (queryer.Get<Name>(entity).name == "first") {
+				firstName = entity;
+			} else if (queryer.Get<Name>(entity).name == "last") {
+				lastName = entity;
+			}
+		}
+		CHECK(internal::entity_version(firstName), 1);
+		CHECK(internal::entity_id(lastName), 1016);
+		size_t maxId = 0;
+		for (Entity entity : timers) {
+			maxId = std::max<size_t>(maxId, internal::entity_id(entity));
+		}
+		CHECK(maxId, 1005);
+	}
+}
+
+void destroyAllSystem(Commands& commands, Queryer& queryer) {
+	commands.DestroyAll<Timer>();
+	commands.DestroyAll<Name, Without<ID>>();
+}
+
+struct ResDestroyAdded {
+	bool armed {false};
+};
+
+void setResourceDestroyAdded(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResDestroyAdded>(ResDestroyAdded{});
+}
+
+void destroyAddedSystem(Commands& commands, Queryer& queryer) {
+	if (queryer.GetResource<ResDestroyAdded>().armed) {
+		commands.DestroyAll<Added<Timer>>();
+	}
+}
+
+void spawnTimerSystem(Commands& commands, Queryer& queryer) {
+	commands.Spawn<ID, Timer>(ID{-1}, Timer{0});
+}
+
+void Cppunit_tests::testDestroyAll() {
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		world.AddGroup<Name, ID>();
+		Queryer queryer(world);
+
+		world.AddSystem(setResourceSystem4);
+		world.Update();
+		world.RemoveSystem(setResourceSystem4);
+
+		//10个ID/Name实体(3个同时有), 以及1000个ID+Timer和10个Name+ID
+		world.AddSystem(spawnSystem4);
+		world.AddSystem(spawnBatchSystem);
+		world.Update();
+		world.RemoveSystem(spawnSystem4);
+		world.RemoveSystem(spawnBatchSystem);
+		std::vector<Entity> timers = queryer.Query<Timer>();
+		CHECK(timers.size(), 1000);
+
+		world.AddSystem(destroyAllSystem);
+		world.Update();
+		world.RemoveSystem(destroyAllSystem);
+
+		CHECK(queryer.Query<Timer>().size(), 0);
+		CHECK((queryer.Query<Name, Without<ID>>().size()), 0);
+		CHECK(queryer.Query<ID>().size(), 16);
+		CHECK((queryer.Group<Name, ID>().size()), 13);
+		CHECKT(!queryer.Exist(timers[0]));
+
+		bool consistent = true;
+		queryer.Group<const Name, const ID>().each([&](Entity entity, const Name& name, const ID& id) {
+			consistent = consistent && queryer.Exist(entity) && &queryer.Get<ID>(entity) == &id;
+		});
+		CHECKT(consistent);
+
+		//清空后ID被复用, 版本号加一
+		world.Clear();
+		CHECK(queryer.Query<ID>().size(), 0);
+		CHECK((queryer.Group<Name, ID>().size()), 0);
+		CHECKT(queryer.HasResource<ResRecycle>());
+
+		world.AddSystem(spawnBatchSystem);
+		world.Update();
+		world.RemoveSystem(spawnBatchSystem);
+		CHECK(queryer.Query<Timer>().size(), 1000);
+		CHECK((queryer.Group<Name, ID>().size()), 10);
+		size_t recycled = 0;
+		for (Entity entity : queryer.Query<ID>()) {
+			recycled += internal::entity_version(entity) > 0 ? 1 : 0;
+		}
+		CHECK(recycled, 1010);
+
+		//Added只看系统上次运行之后创建的实体
+		world.AddSystem(setResourceDestroyAdded);
+		world.Update();
+		world.RemoveSystem(setResourceDestroyAdded);
+		world.AddSystem(destroyAddedSystem);
+		world.Update();
+		world.AddSystem(spawnTimerSystem);
+		world.Update();
+		world.RemoveSystem(spawnTimerSystem);
+		CHECK(queryer.Query<Timer>().size(), 1001);
+		queryer.GetResource<ResDestroyAdded>().armed = true;
+		world.Update();
+		CHECK(queryer.Query<Timer>().size(), 1000);
+		CHECK((queryer.Group<Name, ID>().size()), 10);
+	}
+}
+
+struct ResInsert {
+	std::vector<Entity> entities;
+};
+
+void setResourceSystem7(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResInsert>(ResInsert{});
+}
+
+//同一帧SpawnAndReturn的实体也可以Insert
+void spawnSystem7(Commands& commands, Queryer& queryer) {
+	auto& entities = queryer.GetResource<ResInsert>().entities;
+	for (int i = 0; i < 10; i++) {
+		Entity entity = commands.SpawnAndReturn<ID>(ID{i});
+		if (i % 2 == 0) {
+			commands.Insert(entity, Name{"n" + std::to_string(i)});
+		}
+		entities.push_back(entity);
+	}
+}
+
+void changeSystem7(Commands& commands, Queryer& queryer) {
+	auto& entities = queryer.GetResource<ResInsert>().entities;
+	for (int i = 0; i < 10; i++) {
+		if (i % 2 == 0) {
+			commands.Remove<ID>(entities[i]);
+		} else {
+			commands.Insert(entities[i], Timer{i});
+		}
+	}
+	commands.Insert(entities[0], Name{"replaced"});
+	commands.Remove<Timer>(entities[1]);
+	commands.Remove<Timer>(entities[0]);
+	commands.Destroy(entities[9]);
+	commands.Insert(entities[9], Name{"destroyed"});
+}
+
+void Cppunit_tests::testInsertRemove() {
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		world.AddGroup<Name, ID>();
+		Queryer queryer(world);
+
+		world.AddSystem(setResourceSystem7);
+		world.Update();
+		world.RemoveSystem(setResourceSystem7);
+		world.AddSystem(spawnSystem7);
+		world.Update();
+		world.RemoveSystem(spawnSystem7);
+
+		auto& entities = queryer.GetResource<ResInsert>().entities;
+		CHECK((queryer.Query<Name, ID>().size()), 5);
+		CHECK((queryer.Group<Name, ID>().size()), 5);
+		CHECKS(queryer.Get<Name>(entities[4]).name, "n4");
+
+		world.AddSystem(changeSystem7);
+		world.Update();
+		world.RemoveSystem(changeSystem7);
+
+		//实体ID不变, 没有增删的组件保持原值
+		CHECK((queryer.Query<Name, Without<ID>>().size()), 5);
+		CHECK(queryer.Query<ID>().size(), 4);
+		CHECK(queryer.Query<Timer>().size(), 3);
+		CHECK((queryer.Group<Name, ID>().size()), 0);
+		CHECKS(queryer.Get<Name>(entities[0]).name, "replaced");
+		CHECKS(queryer.Get<Name>(entities[2]).name, "n2");
+		CHECK(queryer.Get<Timer>(entities[3]).t, 3);
+		CHECK(queryer.Get<ID>(entities[7]).id, 7);
+		CHECKT(!queryer.Has<Timer>(entities[1]));
+		CHECKT(!queryer.Exist(entities[9]));
+
+		bool consistent = true;
+		queryer.Each<const ID, const Timer>([&](Entity entity, const ID& id, const Timer& timer) {
+			consistent = consistent && id.id == timer.t && &queryer.Get<ID>(entity) == &id;
+		});
+		CHECKT(consistent);
+	}
+}
+
+struct ResChange {
+	std::vector<Entity> entities;
+	int frame {0};
+	std::vector<size_t> added;
+	std::vector<size_t> changed;
+	std::vector<size_t> names;
+};
+
+void setResourceSystem8(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResChange>(ResChange{});
+}
+
+void spawnSystem8(Commands& commands, Queryer& queryer) {
+	auto& entities = queryer.GetResource<ResChange>().entities;
+	for (int i = 0; i < 10; i++) {
+		entities.push_back(commands.SpawnAndReturn<ID, Timer>(ID{i}, Timer{0}));
+	}
+}
+
+//只读访问, 不会把组件记为修改
+void countSystem8(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResChange>();
+	res.added.push_back(queryer.Query<Added<ID>>().size());
+	size_t changed = 0;
+	queryer.Each<const Timer, Changed<Timer>>([&changed](const Timer&) {
+		changed++;
+	});
+	res.changed.push_back(changed);
+	auto view = queryer.View<Added<Name>>();
+	res.names.push_back(std::distance(view.begin(), view.end()));
+}
+
+void touchSystem8(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResChange>();
+	int frame = res.frame++;
+	queryer.Get<Timer>(res.entities[frame]).t++;
+	if (frame == 1) {
+		commands.Insert(res.entities[5], Timer{100});
+		commands.Insert(res.entities[6], Name{"six"});
+	} else if (frame == 2) {
+		queryer.Each<Timer>([](Timer&) {});
+	}
+}
+
+void queryOnlySystem8(Commands& commands, Queryer& queryer) {
+	queryer.Query<Timer>();
+	queryer.Each<Timer>([](Entity) {});
+	queryer.ParEach<Timer>(commands, [](Commands&, Entity) {});
+	//ParEach中用Get<const T>读取其他实体
+	auto& entities = queryer.GetResource<ResChange>().entities;
+	queryer.ParEach<const ID>([&](const ID& id) {
+		Entity other = entities[(id.id + 1) % entities.size()];
+		if (queryer.Has<Timer>(other)) {
+			queryer.Get<const Timer>(other);
+		}
+	});
+}
+
+void Cppunit_tests::testChangeDetection() {
+	for (StorageMode storageMode : {StorageMode::SparseSet, StorageMode::Archetype}) {
+		World world(storageMode);
+		Queryer queryer(world);
+
+		world.AddSystem(setResourceSystem8);
+		world.Update();
+		world.RemoveSystem(setResourceSystem8);
+		world.AddSystem(spawnSystem8);
+		world.Update();
+		world.RemoveSystem(spawnSystem8);
+
+		world.AddSystem(countSystem8);
+		world.AddSystem(touchSystem8);
+		for (int i = 0; i < 5; i++) {
+			world.Update();
+		}
+
+		//第一次运行时所有组件都是新的; 之后只看到上次运行后touchSystem8的修改和Commands的Insert
+		auto& res = queryer.GetResource<ResChange>();
+		CHECKT((res.added == std::vector<size_t>{10, 0, 0, 0, 0}));
+		CHECKT((res.changed == std::vector<size_t>{10, 1, 2, 10, 1}));
+		CHECKT((res.names == std::vector<size_t>{0, 0, 1, 0, 0}));
+		CHECK(queryer.Get<const Timer>(res.entities[4]).t, 1);
+		CHECK(queryer.Get<const Timer>(res.entities[5]).t, 100);
+		CHECKT(queryer.Has<Name>(res.entities[6]));
+
+		//不交出组件的遍历不记为修改
+		world.RemoveSystem(touchSystem8);
+		world.AddSystem(queryOnlySystem8);
+		world.Update();
+		world.Update();
+		CHECK(res.changed.back(), 0);
+	}
+}
+
+struct Hit {
+	int damage;
+};
+
+struct ResEvents {
+	int frame {0};
+	std::vector<int> before;
+	std::vector<int> after;
+	std::vector<int> late;
+	bool readTwice {false};
+};
+
+void setResourceSystem9(Commands& commands, Queryer& queryer) {
+	commands.SetResource<ResEvents>(ResEvents{});
+}
+
+void sendSystem9(Commands& commands, Queryer& queryer) {
+	int frame = queryer.GetResource<ResEvents>().frame++;
+	for (int i = 0; i < 3; i++) {
+		commands.SendEvent(Hit{frame * 10 + i});
+	}
+}
+
+void readBeforeSystem9(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResEvents>();
+	for (const Hit& hit : queryer.ReadEvents<Hit>()) {
+		res.before.push_back(hit.damage);
+	}
+	res.readTwice = res.readTwice || !queryer.ReadEvents<Hit>().empty();
+}
+
+void readAfterSystem9(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResEvents>();
+	for (const Hit& hit : queryer.ReadEvents<Hit>()) {
+		res.after.push_back(hit.damage);
+	}
+}
+
+void readLateSystem9(Commands& commands, Queryer& queryer) {
+	auto& res = queryer.GetResource<ResEvents>();
+	for (const Hit& hit : queryer.ReadEvents<Hit>()) {
+		res.late.push_back(hit.damage);
+	}
+}
+
+void Cppunit_tests::testEvents() {
+	World world;
+	Queryer queryer(world);
+
+	world.AddSystem(setResourceSystem9);
+	world.Update();
+	world.RemoveSystem(setResourceSystem9);
+
+	//发送的事件下一帧才能读到, 和读取的系统在发送之前还是之后运行无关
+	world.AddSystem(readBeforeSystem9);
+	world.AddSystem(sendSystem9);
+	world.AddSystem(readAfterSystem9);
+	for (int i = 0; i < 4; i++) {
+		world.Update();
+	}
+	auto& res = queryer.GetResource<ResEvents>();
+	std::vector<int> expected {0, 1, 2, 10, 11, 12, 20, 21, 22};
+	CHECKT(res.before == expected);
+	CHECKT(res.after == expected);
+	CHECKT(!res.readTwice);
+
+	//只保留最近两帧的事件, 在系统外读取不移动游标
+	auto events = queryer.ReadEvents<Hit>();
+	CHECK(events.size(), 6);
+	CHECK(events[0].damage, 20);
+	CHECK(events[5].damage, 32);
+	CHECK(queryer.ReadEvents<Hit>().size(), 6);
+
+	world.AddSystem(readLateSystem9);
+	world.Update();
+	CHECKT((res.late == std::vector<int>{20, 21, 22, 30, 31, 32}));
+	CHECK(res.before.size(), 12);
+	CHECK(res.after.back(), 32);
+}
+
+struct Velocity {
+	float x, y;
+};
+
+namespace {
+
+//test-type-registry-tu.cpp的匿名命名空间里有同名的类型
+struct Local {
+	int value;
+};
+
+}
+
+void spawnLayoutSystem(Commands& commands, Queryer& queryer) {
+	commands.Spawn<ID, Timer>(ID{1}, Timer{1});
+	commands.Spawn<Name, ID>(Name{"layout"}, ID{2});
+}
+
+void Cppunit_tests::testTypeRegistry() {
+	//哈希在编译期算出, 只和类型名有关
+	static_assert(type_hash<Velocity>() == TypeRegistry<Component>::Hash<Velocity>());
+	static_assert(type_hash<Velocity>() != type_hash<Timer>());
+	CHECKT(type_name<Velocity>().find("Velocity") != std::string_view::npos);
+	CHECKT(type_name<Velocity>().find("type_name") == std::string_view::npos);
+
+	//ID在main之前注册好, 同一个类型在不同类别里分别编号
+	ComponentID id = TypeRegistry<Component>::Get<Velocity>();
+	CHECKT(id > 0);
+	CHECK(TypeRegistry<Component>::Get<Velocity>(), id);
+	CHECKT(TypeRegistry<Component>::Get<Timer>() != id);
+	CHECKT(TypeRegistry<Resource>::Get<Velocity>() > 0);
+	CHECKT(TypeRegistry<Component>::Hash(id) == type_hash<Velocity>());
+	CHECK(TypeRegistry<Component>::Find(type_hash<Velocity>()), id);
+	CHECK(TypeRegistry<Component>::Find(0), 0);
+	CHECKT(TypeRegistry<Component>::Hash(0) == 0);
+
+	//两个翻译单元匿名命名空间里的同名类型名字和哈希相同, 但是不同的类型, ID不同, 按哈希找不到
+	ComponentID local = TypeRegistry<Component>::Get<Local>();
+	CHECKT(local != otherLocalComponentId());
+	CHECKT(TypeRegistry<Component>::Hash(local) == TypeRegistry<Component>::Hash(otherLocalComponentId()));
+	CHECK(TypeRegistry<Component>::Find(type_hash<Local>()), 0);
+
+	//多个线程同时注册, 同一个哈希只得到一个ID
+	const char* names[] = {"RegA", "RegB", "RegC", "RegD"};
+	std::vector<std::vector<ComponentID>> ids(4);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < 4; i++) {
+				const char* name = names[(t + i) % 4];
+				ids[t].push_back(TypeRegistry<Event>::Register(internal::fnv1a(name), name));
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (int t = 0; t < 4; t++) {
+		for (int i = 0; i < 4; i++) {
+			CHECK(ids[t][i], ids[0][(t + i) % 4]);
+		}
+		CHECK(TypeRegistry<Event>::Find(internal::fnv1a(names[t])), ids[0][t]);
+	}
+
+	//Register保存名字的副本, 传入的字符串可以是临时的
+	ComponentID dynamic = 0;
+	{
+		std::string name = std::string("Dynamically") + "RegisteredType";
+		dynamic = TypeRegistry<Event>::Register(internal::fnv1a(name), name);
+	}
+	CHECK(TypeRegistry<Event>::Register(internal::fnv1a("DynamicallyRegisteredType"), std::string("DynamicallyRegisteredType")), dynamic);
+
+	//保存World布局时只记录哈希, 加载时用Find换回本次运行的ID
+	World world;
+	world.AddSystem(spawnLayoutSystem);
+	world.Update();
+	Queryer queryer(world);
+	auto layoutOf = [&queryer](Entity entity) {
+		std::vector<ComponentID> layout;
+		if (queryer.Has<Name>(entity)) {
+			layout.push_back(TypeRegistry<Component>::Get<Name>());
+		}
+		if (queryer.Has<ID>(entity)) {
+			layout.push_back(TypeRegistry<Component>::Get<ID>());
+		}
+		if (queryer.Has<Timer>(entity)) {
+			layout.push_back(TypeRegistry<Component>::Get<Timer>());
+		}
+		return layout;
+	};
+	std::vector<std::vector<ComponentID>> layouts;
+	std::vector<std::vector<type_hash_type>> saved;
+	queryer.Each<const ID>([&](Entity entity, const ID&) {
+		layouts.push_back(layoutOf(entity));
+		saved.emplace_back();
+		for (ComponentID componentId : layouts.back()) {
+			saved.back().push_back(TypeRegistry<Component>::Hash(componentId));
+		}
+	});
+	std::vector<std::vector<ComponentID>> loaded;
+	for (auto& hashes : saved) {
+		loaded.emplace_back();
+		for (type_hash_type hash : hashes) {
+			loaded.back().push_back(TypeRegistry<Component>::Find(hash));
+		}
+	}
+	CHECK(saved.size(), 2);
+	CHECKT((std::find(saved.begin(), saved.end(), std::vector<type_hash_type>{type_hash<ID>(), type_hash<Timer>()}) != saved.end()));
+	CHECKT(loaded == layouts);
+}
+
 /*
 void StartUpSystem(Commands &commands) {
 	commands.Spawn<Name>(Name{"person1"});
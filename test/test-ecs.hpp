@@ -25,16 +25,54 @@ struct TestResult {
 
 using TestResultList = std::vector<TestResult>;
 
+//test-type-registry-tu.cpp匿名命名空间里Local的组件ID, 见testTypeRegistry
+cppecs::ComponentID otherLocalComponentId();
+
 // Test examples.
 class Cppunit_tests: public Cppunit {
 
 	void testEntity();
 	void testResource();
 	void testSystem();
+	void testStorage();
+	void testArena();
+	void testEntityRecycle();
+	void testArchetype();
+	void testGroup();
+	void testSchedule();
+	void testParEach();
+	void testSpawnBatch();
+	void testDestroyAll();
+	void testInsertRemove();
+	void testChangeDetection();
+	void testEvents();
+	void testTypeRegistry();
+	void testSparsePages();
+	void testContainN();
+	void testSort();
+
+	void checkEntity(cppecs::StorageMode storageMode);
+	void checkSystem(cppecs::StorageMode storageMode);
 
     void test_list() {
         testEntity();
         testResource();
         testSystem();
+        testStorage();
+        testArena();
+        testEntityRecycle();
+        testArchetype();
+        testGroup();
+        testSchedule();
+        testParEach();
+        testSpawnBatch();
+        testDestroyAll();
+        testInsertRemove();
+        testChangeDetection();
+        testEvents();
+        testTypeRegistry();
+        testSparsePages();
+        testContainN();
+        testSort();
     }
 };
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include "test-ecs.hpp"
+
+//和test-ecs.cpp不同的翻译单元, 见testTypeRegistry
+
+namespace {
+
+//test-ecs.cpp的匿名命名空间里有同名的类型
+struct Local {
+	int value;
+};
+
+}
+
+cppecs::ComponentID otherLocalComponentId() {
+	return cppecs::TypeRegistry<cppecs::Component>::Get<Local>();
+}